@@ -0,0 +1,45 @@
+#!/bin/bash
+# times each example program, and the heavier programs next to this script, compiled at -O0 and at -O2, to see
+# what the optimiser buys at run time
+#
+# usage, from the top of the repository: benchmarks/runtimes.sh [acornc] [runs]
+
+set -e
+
+acornc=${1:-./build/src/acornc}
+runs=${2:-20}
+
+output_directory=$(mktemp -d)
+trap 'rm -rf "$output_directory"' EXIT
+
+# the mean wall time of a run in milliseconds, or nothing if the program doesn't exit cleanly
+time_runs() {
+    local start end
+    start=$(date +%s%N)
+    for _ in $(seq "$runs"); do
+        "$1" > /dev/null 2>&1 || return 0
+    done
+    end=$(date +%s%N)
+    awk -v nanoseconds=$((end - start)) -v runs="$runs" 'BEGIN { printf "%.2f", nanoseconds / runs / 1000000 }'
+}
+
+printf "%-28s %10s %10s\n" "program" "-O0 (ms)" "-O2 (ms)"
+
+for source in test/examples/*.acorn benchmarks/*.acorn; do
+    name=$(basename "$source" .acorn)
+
+    results=()
+    for level in 0 2; do
+        executable="$output_directory/$name-O$level"
+        if "$acornc" -O$level -o "$executable" "$source" > /dev/null 2>&1; then
+            results+=("$(time_runs "$executable")")
+        else
+            results+=("")
+        fi
+    done
+
+    # the examples that shouldn't compile, or should abort, have nothing to time
+    if [ -n "${results[0]}" ] && [ -n "${results[1]}" ]; then
+        printf "%-28s %10s %10s\n" "$name" "${results[0]}" "${results[1]}"
+    fi
+done
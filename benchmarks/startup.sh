@@ -0,0 +1,31 @@
+#!/bin/bash
+# times acornc --emit=obj on the smallest program with only the host's backend initialised, which is the default,
+# and with every backend acornc was built with, which --target asks for
+#
+# usage, from the top of the repository: benchmarks/startup.sh [acornc] [runs]
+
+set -e
+
+acornc=${1:-./build/src/acornc}
+runs=${2:-20}
+
+# naming the host explicitly still counts as cross compiling, so it's only the initialisation that differs
+host=$(cc -dumpmachine)
+
+output_directory=$(mktemp -d)
+trap 'rm -rf "$output_directory"' EXIT
+
+# the mean wall time of a compile in milliseconds
+time_compiles() {
+    local start end
+    start=$(date +%s%N)
+    for _ in $(seq "$runs"); do
+        "$acornc" --emit=obj -o "$output_directory/minimal.o" "$@" test/examples/minimal.acorn > /dev/null 2>&1
+    done
+    end=$(date +%s%N)
+    awk -v nanoseconds=$((end - start)) -v runs="$runs" 'BEGIN { printf "%.2f", nanoseconds / runs / 1000000 }'
+}
+
+printf "%-16s %10s\n" "backends" "time (ms)"
+printf "%-16s %10s\n" "host only" "$(time_compiles)"
+printf "%-16s %10s\n" "all" "$(time_compiles --target="$host")"
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <memory>
+
+#include "nodes.h"
+
+namespace acorn::ast {
+
+    // a deep copy of a parsed tree, without any types, so it can be checked independently
+    std::unique_ptr<Node> clone(Node *node);
+
+    template <typename T>
+    std::unique_ptr<T> clone(T *node) {
+        return std::unique_ptr<T>(llvm::cast_or_null<T>(clone(static_cast<Node *>(node)).release()));
+    }
+
+}
@@ -63,6 +63,7 @@ namespace acorn::ast {
             NK_Cast,
             NK_Assignment,
             NK_While,
+            NK_For,
             NK_If,
             NK_Return,
             NK_Spawn,
@@ -408,7 +409,11 @@ namespace acorn::ast {
             m_inferred_type_parameters[parameter] = type;
         }
 
-        std::map<typesystem::ParameterType *, typesystem::Type *> inferred_type_parameters() const {
+        void set_inferred_type_parameters(const std::map<typesystem::ParameterType *, typesystem::Type *> &parameters) {
+            m_inferred_type_parameters = parameters;
+        }
+
+        const std::map<typesystem::ParameterType *, typesystem::Type *> &inferred_type_parameters() const {
             return m_inferred_type_parameters;
         }
 
@@ -498,24 +503,29 @@ namespace acorn::ast {
 
     class Assignment : public Node {
     public:
-        Assignment(Token token, std::unique_ptr<VarDecl> lhs, std::unique_ptr<Node> rhs);
+        Assignment(Token token, std::unique_ptr<Node> lhs, std::unique_ptr<Node> rhs);
 
-        VarDecl *lhs() const {
+        // a variable being declared, or an existing variable or field being given a new value
+        Node *lhs() const {
             return m_lhs.get();
         }
 
+        VarDecl *declaration() const {
+            return llvm::dyn_cast<VarDecl>(m_lhs.get());
+        }
+
         Node *rhs() const {
             return m_rhs.get();
         }
 
-        bool builtin() const { return m_lhs->builtin(); }
+        bool builtin() const { return declaration() != nullptr && declaration()->builtin(); }
 
         static bool classof(const Node *node) {
             return node->kind() == NK_Assignment;
         }
 
     private:
-        std::unique_ptr<VarDecl> m_lhs;
+        std::unique_ptr<Node> m_lhs;
         std::unique_ptr<Node> m_rhs;
     };
 
@@ -554,6 +564,26 @@ namespace acorn::ast {
         std::unique_ptr<Node> m_body;
     };
 
+    class For : public Node {
+    public:
+        For(Token token, std::unique_ptr<VarDecl> variable, std::unique_ptr<Node> iterable, std::unique_ptr<Node> body);
+
+        std::unique_ptr<VarDecl> &variable() { return m_variable; }
+
+        std::unique_ptr<Node> &iterable() { return m_iterable; }
+
+        std::unique_ptr<Node> &body() { return m_body; }
+
+        static bool classof(const Node *node) {
+            return node->kind() == NK_For;
+        }
+
+    private:
+        std::unique_ptr<VarDecl> m_variable;
+        std::unique_ptr<Node> m_iterable;
+        std::unique_ptr<Node> m_body;
+    };
+
     class If : public Node {
     public:
         If(Token token, std::unique_ptr<Node> condition, std::unique_ptr<Node> true_case, std::unique_ptr<Node> false_case);
@@ -27,6 +27,7 @@ namespace acorn::ast {
     class Assignment;
     class Selector;
     class While;
+    class For;
     class If;
     class Return;
     class Spawn;
@@ -72,6 +73,7 @@ namespace acorn::ast {
         virtual void visit_assignment(Assignment *node);
         virtual void visit_selector(Selector *node);
         virtual void visit_while(While *node);
+        virtual void visit_for(For *node);
         virtual void visit_if(If *node);
         virtual void visit_return(Return *node);
         virtual void visit_spawn(Spawn *node);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/SHA1.h>
+
+#include "diagnostics.h"
+
+namespace acorn::cache {
+
+    // builds a cache key from everything that can change the compiler's output
+    class KeyBuilder {
+    public:
+        void add(llvm::StringRef data);
+        bool add_file(const std::string &filename);
+
+        std::string key();
+
+    private:
+        llvm::SHA1 m_sha1;
+    };
+
+    // content addressed store of executables and per function objects, laid out like ccache
+    class Cache {
+    public:
+        explicit Cache(std::string directory);
+
+        bool restore(const std::string &key, const std::string &output_name);
+        void store(const std::string &key, const std::string &output_name);
+
+        bool load_object(const std::string &key, llvm::SmallVectorImpl<char> &object);
+        void store_object(const std::string &key, llvm::ArrayRef<char> object);
+
+    private:
+        bool create_temporary_entry(const std::string &key, int &fd, llvm::SmallVectorImpl<char> &path);
+
+        std::string get_entry_directory(const std::string &key) const;
+        std::string get_entry_path(const std::string &key) const;
+
+    private:
+        diagnostics::Logger m_logger;
+        std::string m_directory;
+    };
+
+}
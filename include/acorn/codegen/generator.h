@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+#include <set>
 #include <string>
 
 #include <llvm/IR/MDBuilder.h>
@@ -11,6 +13,7 @@
 
 #include "followers.h"
 #include "irbuilder.h"
+#include "reachability.h"
 
 namespace llvm {
     class Module;
@@ -22,6 +25,7 @@ namespace acorn {
 
     namespace symboltable {
         class Namespace;
+        class Symbol;
     }
 
 }
@@ -31,9 +35,10 @@ namespace acorn::codegen {
     class CodeGenerator : public ast::Visitor, public typesystem::Visitor, public diagnostics::Reporter, public symboltable::ScopeFollower, public ValueFollower, public TypeFollower, public InitialiserFollower, public IrBuilder {
 
     public:
-        CodeGenerator(symboltable::Namespace *scope, llvm::DataLayout *data_layout);
+        CodeGenerator(llvm::LLVMContext &context, symboltable::Namespace *scope, llvm::DataLayout *data_layout);
 
         llvm::Module *module() const { return m_module.get(); }
+        std::unique_ptr<llvm::Module> take_module() { return std::move(m_module); }
 
         llvm::Type *take_type();
         llvm::Constant *take_initialiser();
@@ -47,6 +52,8 @@ namespace acorn::codegen {
         void pop_replacement_generic_specialisation(std::map<typesystem::ParameterType *, typesystem::Type *> specialisation);
         typesystem::Type *get_replacement_type_parameter(typesystem::ParameterType *key);
         typesystem::Type *get_replacement_type_parameter(typesystem::Parameter *key);
+        typesystem::Type *replace_type_parameters(typesystem::Type *type);
+        int get_concrete_specialisation_index(typesystem::Method *method, int specialisation_index);
 
         void push_llvm_type_and_initialiser(llvm::Type *type, llvm::Constant *initialiser);
         void push_null_llvm_type_and_initialiser();
@@ -54,12 +61,28 @@ namespace acorn::codegen {
         bool verify_function(ast::Node *node, llvm::Function *function);
 
         llvm::Function *create_function(llvm::Type *type, std::string name) const;
+        llvm::Function *get_specialised_function(typesystem::Method *method, int specialisation_index);
+        llvm::Function *generate_specialised_function(ast::DefDecl *node, symboltable::Symbol *symbol, int specialisation_index);
+        void generate_pending_specialised_functions();
+        bool generate_definition(ast::DefDecl *node);
         llvm::GlobalVariable *create_global_variable(llvm::Type *type, llvm::Constant *initialiser, std::string name);
+        llvm::Constant *get_runtime_function(std::string name, llvm::FunctionType *type);
+        llvm::Constant *get_string_literal(std::string value);
+        void generate_runtime_initialisation();
         void prepare_method_parameters(ast::DefDecl *node, llvm::Function *function);
 
         llvm::Value *generate_builtin_variable(ast::VarDecl *node);
+        llvm::Value *generate_builtin_method_call(ast::DefDecl *node, ast::Call *call, std::vector<llvm::Value *> arguments, llvm::Type *return_type, typesystem::Type *type);
+        llvm::Value *generate_dictionary_method_call(std::string name, std::vector<llvm::Value *> arguments, llvm::Type *return_type);
+        std::vector<llvm::Value *> generate_dictionary_layout(ast::Node *node, typesystem::Dictionary *type);
+        llvm::Value *generate_bounds_check(llvm::Value *index, llvm::Value *length);
         void generate_builtin_method_body(ast::DefDecl *node, llvm::Function *function);
 
+        bool generate_call_function(ast::Call *node, llvm::Value *&function, ast::DefDecl *&builtin_definition);
+        bool generate_call_arguments(ast::Call *node, std::vector<llvm::Value *> &arguments);
+        llvm::Value *generate_record_construction(ast::Call *node, std::vector<llvm::Value *> arguments);
+        llvm::Function *generate_spawn_thunk(llvm::StructType *frame_type);
+
         llvm::Value *generate_llvm_value(ast::Node *node);
 
         llvm::Value *generate_llvm_value(std::unique_ptr<ast::Node> &node) {
@@ -77,6 +100,8 @@ namespace acorn::codegen {
         void visit(typesystem::UnsignedIntegerType *type) override;
         void visit(typesystem::FloatType *type) override;
         void visit(typesystem::UnsafePointerType *type) override;
+        void visit(typesystem::TaskType *type) override;
+        void visit(typesystem::DictionaryType *type) override;
         void visit(typesystem::FunctionType *type) override;
         void visit(typesystem::MethodType *type) override;
         void visit(typesystem::RecordType *type) override;
@@ -91,6 +116,8 @@ namespace acorn::codegen {
         void visit(typesystem::UnsignedInteger *type) override;
         void visit(typesystem::Float *type) override;
         void visit(typesystem::UnsafePointer *type) override;
+        void visit(typesystem::Task *type) override;
+        void visit(typesystem::Dictionary *type) override;
         void visit(typesystem::Record *type) override;
         void visit(typesystem::Tuple *type) override;
         void visit(typesystem::Method *type) override;
@@ -112,6 +139,7 @@ namespace acorn::codegen {
         void visit_assignment(ast::Assignment *node) override;
         void visit_selector(ast::Selector *node) override;
         void visit_while(ast::While *node) override;
+        void visit_for(ast::For *node) override;
         void visit_if(ast::If *node) override;
         void visit_return(ast::Return *node) override;
         void visit_spawn(ast::Spawn *node) override;
@@ -126,15 +154,25 @@ namespace acorn::codegen {
     private:
         diagnostics::Logger m_logger;
 
-        llvm::LLVMContext m_context;
+        llvm::LLVMContext &m_context;
         std::unique_ptr<llvm::Module> m_module;
         std::unique_ptr<llvm::MDBuilder> m_md_builder;
         llvm::DataLayout *m_data_layout;
 
+        Reachability m_reachability;
+        std::map<std::pair<typesystem::Method *, int>, llvm::Function *> m_specialised_functions;
+
+        // specialisations only found once the generic methods calling them were generated
+        std::map<typesystem::Method *, symboltable::Symbol *> m_method_symbols;
+        std::set<std::pair<typesystem::Method *, int>> m_queued_specialisations;
+        std::deque<std::pair<typesystem::Method *, int>> m_pending_specialisations;
+
         std::vector<llvm::Argument *> m_args;
         std::map<typesystem::ParameterType *, typesystem::Type *> m_replacement_type_parameters;
 
         llvm::Function *m_init_variables_function;
+        std::vector<llvm::GlobalVariable *> m_global_variables;
+        std::map<std::string, llvm::Constant *> m_string_literals;
     };
 
 }
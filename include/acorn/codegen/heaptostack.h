@@ -0,0 +1,30 @@
+#pragma once
+
+#include <llvm/Pass.h>
+
+namespace llvm {
+    class CallInst;
+    class Value;
+}
+
+namespace acorn::codegen {
+
+    // replaces small GC allocations that never leave their function with zeroed stack memory
+    class HeapToStack : public llvm::FunctionPass {
+    public:
+        static char ID;
+
+        HeapToStack();
+
+        bool runOnFunction(llvm::Function &function) override;
+        void getAnalysisUsage(llvm::AnalysisUsage &usage) const override;
+
+    private:
+        bool is_candidate(llvm::CallInst *call) const;
+        bool is_escaping(llvm::Value *pointer) const;
+        void move_to_stack(llvm::CallInst *call);
+    };
+
+    llvm::FunctionPass *create_heap_to_stack_pass();
+
+}
@@ -22,6 +22,7 @@ namespace acorn::codegen {
 
         llvm::BasicBlock *create_basic_block(std::string name, llvm::Function *function = nullptr, bool set_insert_point = false);
         llvm::BasicBlock *create_entry_basic_block(llvm::Function *function = nullptr, bool set_insert_point = false);
+        llvm::AllocaInst *create_entry_block_alloca(llvm::Type *type, std::string name = "");
 
         std::vector<llvm::Value *> build_gep_index(std::initializer_list<int> indexes);
         llvm::Value *create_inbounds_gep(llvm::Value *value, std::initializer_list<int> indexes);
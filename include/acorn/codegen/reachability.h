@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "../ast/visitor.h"
+#include "../diagnostics.h"
+
+namespace acorn::typesystem {
+    class Function;
+    class Method;
+}
+
+namespace acorn::codegen {
+
+    // finds the method specialisations which can be called from top level code
+    class Reachability : public ast::Visitor {
+    public:
+        Reachability();
+
+        bool is_reachable(typesystem::Method *method, int specialisation_index) const;
+        bool is_escaping(typesystem::Function *function) const;
+
+        ast::DefDecl *definition_of(typesystem::Method *method) const;
+
+        void visit_name(ast::Name *node) override;
+        void visit_call(ast::Call *node) override;
+        void visit_selector(ast::Selector *node) override;
+        void visit_def_decl(ast::DefDecl *node) override;
+        void visit_source_file(ast::SourceFile *node) override;
+
+    private:
+        void mark_reachable(typesystem::Method *method, int specialisation_index);
+        void mark_escaping(typesystem::Function *function);
+        void visit_pending_methods();
+        void remove_inlined_builtins();
+
+    private:
+        diagnostics::Logger m_logger;
+
+        int m_source_file_depth;
+
+        std::map<typesystem::Method *, ast::DefDecl *> m_definitions;
+        std::set<std::pair<typesystem::Method *, int>> m_reachable;
+        std::set<typesystem::Function *> m_escaping;
+        std::set<typesystem::Method *> m_escaping_methods;
+        std::set<ast::DefDecl *> m_visited_definitions;
+        std::vector<typesystem::Method *> m_pending_methods;
+    };
+
+}
@@ -1,15 +1,20 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/Triple.h>
-#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
 
 #include "diagnostics.h"
+#include "session.h"
+#include "statistics.h"
 
 namespace llvm {
-    class TargetMachine;
+    class Module;
 }
 
 namespace acorn {
@@ -18,6 +23,10 @@ namespace acorn {
         class SourceFile;
     }
 
+    namespace cache {
+        class KeyBuilder;
+    }
+
     namespace symboltable {
         class Namespace;
     }
@@ -26,24 +35,87 @@ namespace acorn {
 
 namespace acorn::compiler {
 
+    enum class EmitKind {
+        AST,
+        LLVMIR,
+        Bitcode,
+        Assembly,
+        Object,
+        Executable
+    };
+
     class Compiler : public diagnostics::Reporter {
 
     public:
-        Compiler();
+        explicit Compiler(session::Session *session = nullptr);
         ~Compiler();
 
         ast::SourceFile *parse(const std::string filename, symboltable::Namespace *root_namespace);
+        bool check(ast::SourceFile *module, symboltable::Namespace *root_namespace);
         bool compile(ast::SourceFile *module, symboltable::Namespace *root_namespace, std::string filename);
+        int run(ast::SourceFile *module, symboltable::Namespace *root_namespace);
 
         int parse_and_compile(const std::string filename);
+        int parse_and_run(const std::string filename);
+
+        void set_optimisation_level(unsigned int level, unsigned int size_level = 0);
+        void set_jobs(unsigned int jobs);
+        void set_target(const std::string triple);
+        void set_cache_directory(const std::string directory);
+        void set_emit_kind(EmitKind emit_kind);
+        void set_output_filename(const std::string filename);
+        void set_working_directory(const std::string directory);
+        void set_time_phases(bool time_phases);
+        void set_statistics_filename(const std::string filename);
+
+        void report_statistics();
 
     private:
+        std::string resolve_path(const std::string path) const;
+        std::string get_output_name(const std::string filename) const;
+        bool add_target_to_key(cache::KeyBuilder &key_builder) const;
+        std::string get_cache_key(ast::SourceFile *module) const;
+
+        bool is_cross_compiling() const;
+
         llvm::Triple get_triple() const;
-        llvm::TargetMachine *get_target_machine(llvm::Triple triple) const;
+        llvm::CodeGenOpt::Level get_codegen_optimisation_level() const;
+        std::string get_target_cpu() const;
+        std::string get_target_features() const;
+        session::Target *get_target(llvm::Triple triple);
+
+        void optimise(llvm::Module *module, llvm::TargetMachine *target_machine) const;
+
+        void emit_partitioned_objects(std::unique_ptr<llvm::Module> module, llvm::Triple triple,
+                                      std::vector<llvm::SmallVector<char, 0>> &objects);
+        bool emit_incremental_objects(std::unique_ptr<llvm::Module> module, llvm::TargetMachine *target_machine,
+                                      std::vector<llvm::SmallVector<char, 0>> &objects);
+        void count_instructions(llvm::Module *module);
+        bool emit_ast(ast::SourceFile *module, const std::string &output_name);
+        bool emit_file(llvm::Module *module, llvm::TargetMachine *target_machine, const std::string &output_name);
+        bool emit_object(llvm::Module *module, llvm::TargetMachine *target_machine, llvm::SmallVectorImpl<char> &object,
+                         llvm::TargetMachine::CodeGenFileType file_type = llvm::TargetMachine::CGFT_ObjectFile);
+        bool link(const std::vector<llvm::SmallVector<char, 0>> &objects, const std::string &output_name);
 
     private:
         diagnostics::Logger m_logger;
-        llvm::LLVMContext m_context;
+
+        session::Session *m_session;
+        std::unique_ptr<session::Session> m_own_session;
+
+        unsigned int m_optimisation_level;
+        unsigned int m_size_level;
+        unsigned int m_jobs;
+        std::string m_cache_directory;
+        std::string m_target;
+
+        EmitKind m_emit_kind;
+        std::string m_output_filename;
+        std::string m_working_directory;
+
+        statistics::Statistics m_statistics;
+        bool m_time_phases;
+        std::string m_statistics_filename;
 
     };
 }
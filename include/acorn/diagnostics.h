@@ -104,6 +104,11 @@ namespace acorn::diagnostics {
         ConstantAssignmentError(ast::Node *node);
     };
 
+    class InternalError : public CompilerError {
+    public:
+        InternalError(ast::Node *node, std::string message);
+    };
+
     class Logger {
     public:
         Logger(const char *name = nullptr);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include "diagnostics.h"
+
+namespace llvm {
+    class Module;
+}
+
+namespace acorn::jit {
+
+    // compiles functions lazily, the first time they're called
+    class Jit {
+    public:
+        explicit Jit(llvm::CodeGenOpt::Level optimisation_level);
+
+        llvm::TargetMachine &target_machine();
+        const llvm::DataLayout &data_layout() const;
+
+        void add_module(std::unique_ptr<llvm::Module> module);
+        llvm::JITTargetAddress find_symbol_address(const std::string name);
+
+    private:
+        using ObjectLayer = llvm::orc::RTDyldObjectLinkingLayer;
+        using CompileLayer = llvm::orc::IRCompileLayer<ObjectLayer, llvm::orc::SimpleCompiler>;
+        using CompileOnDemandLayer = llvm::orc::CompileOnDemandLayer<CompileLayer>;
+
+        diagnostics::Logger m_logger;
+
+        std::unique_ptr<llvm::TargetMachine> m_target_machine;
+        const llvm::DataLayout m_data_layout;
+
+        ObjectLayer m_object_layer;
+        CompileLayer m_compile_layer;
+        std::unique_ptr<llvm::orc::JITCompileCallbackManager> m_compile_callback_manager;
+        CompileOnDemandLayer m_compile_on_demand_layer;
+    };
+
+}
@@ -2,8 +2,12 @@
 
 #include <deque>
 #include <map>
+#include <set>
 #include <string>
 
+#include <llvm/Support/Chrono.h>
+
+#include "../ast/nodes.h"
 #include "../ast/visitor.h"
 #include "../diagnostics.h"
 
@@ -11,10 +15,25 @@ namespace acorn::parser {
 
     class Scanner;
 
+    // imports parsed by earlier compiles, handed out as copies since checking annotates them
+    class ImportCache {
+    public:
+        std::unique_ptr<ast::SourceFile> find(const std::string &filename);
+        void insert(ast::SourceFile *source_file);
+
+    private:
+        struct Entry {
+            std::unique_ptr<ast::SourceFile> source_file;
+            std::map<std::string, llvm::sys::TimePoint<>> modification_times;
+        };
+
+        std::map<std::string, Entry> m_entries;
+    };
+
     class Parser : public diagnostics::Reporter {
 
     public:
-        explicit Parser(Scanner &scanner);
+        explicit Parser(Scanner &scanner, std::string import_directory = "stdlib", ImportCache *import_cache = nullptr);
         ~Parser() = default;
 
         std::unique_ptr<ast::SourceFile> parse(std::string name);
@@ -57,7 +76,7 @@ namespace acorn::parser {
         std::unique_ptr<ast::Selector> read_selector(std::unique_ptr<ast::Node> operand, bool allow_operators = false);
         std::unique_ptr<ast::Call> read_index(std::unique_ptr<ast::Node> operand);
         std::unique_ptr<ast::While> read_while();
-        std::unique_ptr<ast::Block> read_for();
+        std::unique_ptr<ast::For> read_for();
         std::unique_ptr<ast::If> read_if();
         std::unique_ptr<ast::Return> read_return();
         std::unique_ptr<ast::Spawn> read_spawn();
@@ -75,9 +94,13 @@ namespace acorn::parser {
         std::unique_ptr<ast::ModuleDecl> read_module_decl();
         std::unique_ptr<ast::Import> read_import_expression();
 
+        void remove_repeated_imports(ast::SourceFile *source_file, std::set<std::string> &seen);
+
     private:
         diagnostics::Logger m_logger;
         Scanner &m_scanner;
+        std::string m_import_directory;
+        ImportCache *m_import_cache;
         std::deque<Token> m_tokens;
         std::map<std::string, int> m_operator_precendence;
 
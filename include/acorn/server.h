@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+
+#include "compiler.h"
+#include "diagnostics.h"
+#include "session.h"
+
+namespace acorn::server {
+
+    // everything a client needs to tell the server to reproduce its command line
+    struct Request {
+        std::string working_directory;
+        std::string filename;
+        std::string output_filename;
+        std::string target;
+        std::string cache_directory;
+        compiler::EmitKind emit_kind = compiler::EmitKind::Executable;
+        unsigned int optimisation_level = 0;
+        unsigned int size_level = 0;
+        unsigned int jobs = 1;
+
+        std::string encode() const;
+        bool decode(const std::string &data);
+    };
+
+    // the exit code the client should exit with, and the errors it should print
+    struct Response {
+        int exit_code = 1;
+        std::string diagnostics;
+
+        std::string encode() const;
+        bool decode(const std::string &data);
+    };
+
+    // serves compile requests sequentially over a Unix socket, keeping LLVM and parsed imports warm between them
+    class Server {
+    public:
+        explicit Server(std::string socket_path);
+
+        int serve();
+
+    private:
+        void handle_connection(int fd);
+        Response compile(const Request &request);
+
+    private:
+        diagnostics::Logger m_logger;
+        std::string m_socket_path;
+        session::Session m_session;
+    };
+
+    int send_request(const std::string &socket_path, const Request &request);
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include "diagnostics.h"
+#include "parser/parser.h"
+
+namespace acorn::session {
+
+    struct Target {
+        std::unique_ptr<llvm::TargetMachine> machine;
+        llvm::DataLayout data_layout;
+    };
+
+    // state that outlives a single compile, so a process compiling many programs only pays for it once
+    class Session {
+    public:
+        Session();
+
+        Target *get_target(const std::string &triple, const std::string &cpu, const std::string &features,
+                           llvm::CodeGenOpt::Level optimisation_level);
+        std::unique_ptr<llvm::TargetMachine> create_target_machine(const std::string &triple, const std::string &cpu,
+                                                                   const std::string &features,
+                                                                   llvm::CodeGenOpt::Level optimisation_level);
+
+        const std::string &host_cpu_name();
+        const std::string &host_cpu_features();
+
+        void initialise_all_targets();
+
+        parser::ImportCache &import_cache() { return m_import_cache; }
+
+    private:
+        friend class ContextLease;
+
+        std::unique_ptr<llvm::LLVMContext> acquire_context();
+        void release_context(std::unique_ptr<llvm::LLVMContext> context);
+
+    private:
+        diagnostics::Logger m_logger;
+
+        std::map<std::string, std::unique_ptr<Target>> m_targets;
+        std::vector<std::unique_ptr<llvm::LLVMContext>> m_contexts;
+        std::map<llvm::LLVMContext *, unsigned int> m_context_uses;
+
+        std::string m_host_cpu_name;
+        std::string m_host_cpu_features;
+        bool m_all_targets_initialised;
+
+        parser::ImportCache m_import_cache;
+    };
+
+    // borrows a context from the session's pool, declare it before anything that lives in the context
+    class ContextLease {
+    public:
+        explicit ContextLease(Session *session);
+        ~ContextLease();
+
+        llvm::LLVMContext &context() { return *m_context; }
+
+    private:
+        Session *m_session;
+        std::unique_ptr<llvm::LLVMContext> m_context;
+    };
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llvm {
+    class raw_ostream;
+}
+
+namespace acorn::statistics {
+
+    // a process wide count of something the compiler did, in the spirit of LLVM's STATISTIC
+    class Counter {
+    public:
+        Counter(const char *name, const char *description);
+
+        Counter &operator++() { m_value++; return *this; }
+        Counter &operator+=(uint64_t value) { m_value += value; return *this; }
+
+        const char *name() const { return m_name; }
+        const char *description() const { return m_description; }
+        uint64_t value() const { return m_value; }
+
+    private:
+        const char *m_name;
+        const char *m_description;
+        uint64_t m_value;
+    };
+
+    struct PhaseRecord {
+        std::string name;
+        double wall_time;
+        double user_time;
+        double system_time;
+        uint64_t peak_rss;
+    };
+
+    class Statistics {
+    public:
+        Statistics();
+
+        void reset();
+
+        void begin_phase(std::string name);
+        void end_phase();
+
+        bool empty() const { return m_phases.empty(); }
+
+        void print_table(llvm::raw_ostream &os) const;
+        void print_json(llvm::raw_ostream &os) const;
+
+    private:
+        uint64_t get_counter_value(size_t index) const;
+
+    private:
+        std::vector<PhaseRecord> m_phases;
+        std::vector<uint64_t> m_counter_baselines;
+
+        PhaseRecord m_current_phase;
+        bool m_in_phase;
+    };
+
+    class ScopedPhase {
+    public:
+        ScopedPhase(Statistics &statistics, std::string name);
+        ~ScopedPhase();
+
+    private:
+        Statistics &m_statistics;
+    };
+
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include <llvm/ADT/ArrayRef.h>
+
 #include "../ast/visitor.h"
 #include "../diagnostics.h"
 #include "../symboltable/builder.h"
@@ -38,8 +43,10 @@ namespace acorn::typesystem {
 
         typesystem::Type *builtin_type_from_name(ast::DeclName *node);
 
-        bool infer_call_type_parameters(ast::Call *call, std::vector<typesystem::Type *> parameter_types,
-                                        std::vector<typesystem::Type *> argument_types);
+        bool infer_call_type_parameters(ast::Call *call, llvm::ArrayRef<typesystem::Type *> parameter_types,
+                                        llvm::ArrayRef<typesystem::Type *> argument_types);
+
+        std::string specialisation_cache_key(const std::vector<typesystem::Type *> &argument_types) const;
 
         typesystem::Type *replace_type_parameters(typesystem::Type *type,
                                                   std::map<typesystem::ParameterType *, typesystem::Type *> replacements);
@@ -47,6 +54,9 @@ namespace acorn::typesystem {
     private:
         void check_types(ast::Node *lhs, ast::Node *rhs);
         void check_not_null(ast::Node *expression);
+        void check_dictionary_key_type(ast::Node *node, typesystem::Type *key_type);
+
+        void visit_reassignment(ast::Assignment *node);
 
     public:
         void visit_node(ast::Node *node) override;
@@ -68,6 +78,7 @@ namespace acorn::typesystem {
         void visit_assignment(ast::Assignment *node) override;
         void visit_selector(ast::Selector *node) override;
         void visit_while(ast::While *node) override;
+        void visit_for(ast::For *node) override;
         void visit_if(ast::If *node) override;
         void visit_return(ast::Return *node) override;
         void visit_spawn(ast::Spawn *node) override;
@@ -85,6 +96,9 @@ namespace acorn::typesystem {
         diagnostics::Logger m_logger;
         std::vector<ast::DefDecl *> m_function_stack;
 
+        // generic specialisation index by method and concrete argument types
+        std::map<std::pair<typesystem::Method *, std::string>, int> m_specialisation_cache;
+
     };
 
 }
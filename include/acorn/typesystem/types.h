@@ -51,7 +51,7 @@ namespace acorn::typesystem {
 
         virtual Type *with_parameters(std::vector<Type *> parameters) = 0;
 
-        std::vector<Type *> parameters() const {
+        const std::vector<Type *> &parameters() const {
             return m_parameters;
         }
 
@@ -182,6 +182,40 @@ namespace acorn::typesystem {
         void accept(Visitor *visitor);
     };
 
+    class TaskType : public TypeType {
+    public:
+        explicit TaskType(TypeType *result_type = nullptr);
+
+        std::string name() const;
+
+        bool has_result_type() const;
+        TypeType *result_type() const;
+
+        Type *create(diagnostics::Reporter *diagnostics, ast::Node *node);
+
+        TaskType *with_parameters(std::vector<TypeType *> parameters);
+
+        void accept(Visitor *visitor);
+    };
+
+    class DictionaryType : public TypeType {
+    public:
+        DictionaryType();
+        DictionaryType(TypeType *key_type, TypeType *value_type);
+
+        std::string name() const;
+
+        bool has_key_and_value_types() const;
+        TypeType *key_type() const;
+        TypeType *value_type() const;
+
+        Type *create(diagnostics::Reporter *diagnostics, ast::Node *node);
+
+        DictionaryType *with_parameters(std::vector<TypeType *> parameters);
+
+        void accept(Visitor *visitor);
+    };
+
     class FunctionType : public TypeType {
     public:
         FunctionType();
@@ -216,10 +250,12 @@ namespace acorn::typesystem {
 
     public:
         RecordType();
-        RecordType(std::vector<ParameterType *> input_parameters,
+        RecordType(std::string declared_name,
+                   std::vector<ParameterType *> input_parameters,
                    std::vector<std::string> field_names,
                    std::vector<TypeType *> field_types);
-        RecordType(std::vector<ParameterType *> input_parameters,
+        RecordType(std::string declared_name,
+                   std::vector<ParameterType *> input_parameters,
                    std::vector<std::string> field_names,
                    std::vector<TypeType *> field_types,
                    std::vector<TypeType *> parameters);
@@ -237,6 +273,7 @@ namespace acorn::typesystem {
     private:
         void create_builtin_constructor();
 
+        std::string m_declared_name;
         std::vector<ParameterType *> m_input_parameters;
         std::vector<std::string> m_field_names;
         std::vector<TypeType *> m_field_types;
@@ -427,9 +464,49 @@ namespace acorn::typesystem {
         void accept(Visitor *visitor);
     };
 
+    class Task : public Type {
+    public:
+        explicit Task(Type *result_type);
+
+        std::string name() const;
+        std::string mangled_name() const;
+
+        TaskType *type() const;
+
+        Type *result_type() const;
+
+        bool is_compatible(const Type *other) const;
+
+        Task *with_parameters(std::vector<Type *> parameters);
+
+        void accept(Visitor *visitor);
+    };
+
+    class Dictionary : public Type {
+    public:
+        Dictionary(Type *key_type, Type *value_type);
+
+        std::string name() const;
+        std::string mangled_name() const;
+
+        DictionaryType *type() const;
+
+        Type *key_type() const;
+        Type *value_type() const;
+
+        bool is_compatible(const Type *other) const;
+
+        Dictionary *with_parameters(std::vector<Type *> parameters);
+
+        void accept(Visitor *visitor);
+    };
+
     class Record : public Type {
     public:
-        Record(std::vector<std::string> field_names, std::vector<Type *> field_types);
+        Record(std::vector<std::string> field_names, std::vector<Type *> field_types, std::string declared_name = "");
+
+        // records are structural, this is only the name of the type declaration it came from
+        std::string declared_name() const;
 
         bool has_field(std::string name);
         long get_field_index(std::string name);
@@ -452,6 +529,7 @@ namespace acorn::typesystem {
 
     protected:
         std::vector<std::string> m_field_names;
+        std::string m_declared_name;
     };
 
     class Tuple : public Record {
@@ -485,7 +563,7 @@ namespace acorn::typesystem {
         bool could_be_called_with(std::vector<Type *> positional_arguments, std::map<std::string, Type *> keyword_arguments);
 
         void add_generic_specialisation(std::map<typesystem::ParameterType *, typesystem::Type *> specialisation);
-        std::vector<std::map<typesystem::ParameterType *, typesystem::Type *> > generic_specialisations();
+        const std::vector<std::map<typesystem::ParameterType *, typesystem::Type *> > &generic_specialisations() const;
         size_t no_generic_specialisation() const;
         void add_empty_specialisation();
 
@@ -530,4 +608,10 @@ namespace acorn::typesystem {
         std::map<Method *, int> m_llvm_index;
     };
 
+    // the standard library iterables loops can count through, matched by the name they were declared with
+    bool is_range(Type *type);
+    bool is_array(Type *type);
+    bool is_array_iterator(Type *type);
+    Type *get_loop_element_type(Type *type);
+
 }
@@ -10,6 +10,8 @@ namespace acorn::typesystem {
     class UnsignedIntegerType;
     class FloatType;
     class UnsafePointerType;
+    class TaskType;
+    class DictionaryType;
     class FunctionType;
     class MethodType;
     class RecordType;
@@ -25,6 +27,8 @@ namespace acorn::typesystem {
     class UnsignedInteger;
     class Float;
     class UnsafePointer;
+    class Task;
+    class Dictionary;
     class Record;
     class Tuple;
     class Method;
@@ -41,6 +45,8 @@ namespace acorn::typesystem {
         virtual void visit(UnsignedIntegerType *type) = 0;
         virtual void visit(FloatType *type) = 0;
         virtual void visit(UnsafePointerType *type) = 0;
+        virtual void visit(TaskType *type) = 0;
+        virtual void visit(DictionaryType *type) = 0;
         virtual void visit(FunctionType *type) = 0;
         virtual void visit(MethodType *type) = 0;
         virtual void visit(RecordType *type) = 0;
@@ -55,6 +61,8 @@ namespace acorn::typesystem {
         virtual void visit(UnsignedInteger *type) = 0;
         virtual void visit(Float *type) = 0;
         virtual void visit(UnsafePointer *type) = 0;
+        virtual void visit(Task *type) = 0;
+        virtual void visit(Dictionary *type) = 0;
         virtual void visit(Record *type) = 0;
         virtual void visit(Tuple *type) = 0;
         virtual void visit(Method *type) = 0;
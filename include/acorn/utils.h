@@ -12,6 +12,9 @@
 #define return_null_if_false(thing) \
     if (thing == false) { return nullptr; }
 
+#define return_false_if_null(thing) \
+    if (thing == nullptr) { return false; }
+
 #define return_if_null_type(node) \
     return_if_false(node->has_type())
 
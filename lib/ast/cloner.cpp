@@ -0,0 +1,179 @@
+#include "acorn/ast/cloner.h"
+
+using namespace acorn;
+using namespace acorn::ast;
+
+template <typename T>
+static std::vector<std::unique_ptr<T>> clone_all(const std::vector<T *> &nodes) {
+    std::vector<std::unique_ptr<T>> clones;
+    for (auto node : nodes) {
+        clones.push_back(clone(node));
+    }
+    return clones;
+}
+
+template <typename T>
+static std::vector<std::unique_ptr<T>> clone_all(const std::vector<std::unique_ptr<T>> &nodes) {
+    std::vector<std::unique_ptr<T>> clones;
+    for (auto &node : nodes) {
+        clones.push_back(clone(node.get()));
+    }
+    return clones;
+}
+
+std::unique_ptr<Node> ast::clone(Node *node) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+
+    auto token = node->token();
+
+    switch (node->kind()) {
+    case Node::NK_Block: {
+        auto block = llvm::cast<Block>(node);
+        return std::make_unique<Block>(token, clone_all(block->expressions()));
+    }
+    case Node::NK_Name:
+        return std::make_unique<Name>(token, llvm::cast<Name>(node)->value());
+    case Node::NK_Selector: {
+        auto selector = llvm::cast<Selector>(node);
+        return std::make_unique<Selector>(token, clone(selector->operand().get()), clone(selector->field().get()));
+    }
+    case Node::NK_TypeName: {
+        auto type_name = llvm::cast<TypeName>(node);
+        return std::make_unique<TypeName>(token, clone(type_name->name()), clone_all(type_name->parameters()));
+    }
+    case Node::NK_DeclName: {
+        auto decl_name = llvm::cast<DeclName>(node);
+        return std::make_unique<DeclName>(token, clone(decl_name->name()), clone_all(decl_name->parameters()));
+    }
+    case Node::NK_ParamName: {
+        auto param_name = llvm::cast<ParamName>(node);
+        return std::make_unique<ParamName>(token, clone(param_name->name()), clone_all(param_name->parameters()));
+    }
+    case Node::NK_VarDecl: {
+        auto var_decl = llvm::cast<VarDecl>(node);
+        return std::make_unique<VarDecl>(
+            token, clone(var_decl->name()), clone(var_decl->given_type()), var_decl->builtin()
+        );
+    }
+    case Node::NK_Int:
+        return std::make_unique<Int>(token, llvm::cast<Int>(node)->value());
+    case Node::NK_Float:
+        return std::make_unique<Float>(token, llvm::cast<Float>(node)->value());
+    case Node::NK_Complex:
+        return std::make_unique<Complex>(token);
+    case Node::NK_String:
+        return std::make_unique<String>(token, llvm::cast<String>(node)->value());
+    case Node::NK_List:
+        return std::make_unique<List>(token, clone_all(llvm::cast<List>(node)->elements()));
+    case Node::NK_Tuple:
+        return std::make_unique<Tuple>(token, clone_all(llvm::cast<Tuple>(node)->elements()));
+    case Node::NK_Dictionary: {
+        auto dictionary = llvm::cast<Dictionary>(node);
+        return std::make_unique<Dictionary>(token, clone_all(dictionary->keys()), clone_all(dictionary->values()));
+    }
+    case Node::NK_Call: {
+        auto call = llvm::cast<Call>(node);
+
+        std::map<std::string, std::unique_ptr<Node>> keyword_arguments;
+        for (auto &entry : call->keyword_arguments()) {
+            keyword_arguments[entry.first] = clone(entry.second);
+        }
+
+        return std::make_unique<Call>(
+            token, clone(call->operand()), clone_all(call->positional_arguments()), std::move(keyword_arguments)
+        );
+    }
+    case Node::NK_CCall: {
+        auto ccall = llvm::cast<CCall>(node);
+        return std::make_unique<CCall>(
+            token, clone(ccall->name()), clone_all(ccall->parameters()), clone(ccall->return_type()),
+            clone_all(ccall->arguments())
+        );
+    }
+    case Node::NK_Cast: {
+        auto cast = llvm::cast<Cast>(node);
+        return std::make_unique<Cast>(token, clone(cast->operand()), clone(cast->new_type()));
+    }
+    case Node::NK_Assignment: {
+        auto assignment = llvm::cast<Assignment>(node);
+        return std::make_unique<Assignment>(token, clone(assignment->lhs()), clone(assignment->rhs()));
+    }
+    case Node::NK_While: {
+        auto while_ = llvm::cast<While>(node);
+        return std::make_unique<While>(token, clone(while_->condition().get()), clone(while_->body().get()));
+    }
+    case Node::NK_For: {
+        auto for_ = llvm::cast<For>(node);
+        return std::make_unique<For>(
+            token, clone(for_->variable().get()), clone(for_->iterable().get()), clone(for_->body().get())
+        );
+    }
+    case Node::NK_If: {
+        auto if_ = llvm::cast<If>(node);
+        return std::make_unique<If>(
+            token, clone(if_->condition().get()), clone(if_->true_case().get()), clone(if_->false_case().get())
+        );
+    }
+    case Node::NK_Return:
+        return std::make_unique<Return>(token, clone(llvm::cast<Return>(node)->expression().get()));
+    case Node::NK_Spawn:
+        return std::make_unique<Spawn>(token, clone(llvm::cast<Spawn>(node)->call().get()));
+    case Node::NK_Case: {
+        auto case_ = llvm::cast<Case>(node);
+        return std::make_unique<Case>(
+            token, clone(case_->condition().get()), clone(case_->assignment().get()), clone(case_->body().get())
+        );
+    }
+    case Node::NK_Switch: {
+        auto switch_ = llvm::cast<Switch>(node);
+        return std::make_unique<Switch>(
+            token, clone(switch_->expression().get()), clone_all(switch_->cases()),
+            clone(switch_->default_case().get())
+        );
+    }
+    case Node::NK_Let:
+        return std::make_unique<Let>(token, clone(llvm::cast<Let>(node)->assignment().get()));
+    case Node::NK_Parameter: {
+        auto parameter = llvm::cast<Parameter>(node);
+        return std::make_unique<Parameter>(
+            token, parameter->inout(), clone(parameter->name()), clone(parameter->given_type())
+        );
+    }
+    case Node::NK_DefDecl: {
+        auto def_decl = llvm::cast<DefDecl>(node);
+        return std::make_unique<DefDecl>(
+            token, clone(def_decl->name()), def_decl->builtin(), clone_all(def_decl->parameters()),
+            clone(def_decl->body().get()), clone(def_decl->return_type().get())
+        );
+    }
+    case Node::NK_TypeDecl: {
+        auto type_decl = llvm::cast<TypeDecl>(node);
+        if (type_decl->builtin()) {
+            return std::make_unique<TypeDecl>(token, clone(type_decl->name()));
+        } else if (type_decl->alias()) {
+            return std::make_unique<TypeDecl>(token, clone(type_decl->name()), clone(type_decl->alias().get()));
+        } else {
+            return std::make_unique<TypeDecl>(
+                token, clone(type_decl->name()), clone_all(type_decl->field_names()),
+                clone_all(type_decl->field_types())
+            );
+        }
+    }
+    case Node::NK_ModuleDecl: {
+        auto module_decl = llvm::cast<ModuleDecl>(node);
+        return std::make_unique<ModuleDecl>(token, clone(module_decl->name()), clone(module_decl->body().get()));
+    }
+    case Node::NK_Import:
+        return std::make_unique<Import>(token, clone(llvm::cast<Import>(node)->path().get()));
+    case Node::NK_SourceFile: {
+        auto source_file = llvm::cast<SourceFile>(node);
+        return std::make_unique<SourceFile>(
+            token, source_file->name(), clone_all(source_file->imports()), clone(source_file->code().get())
+        );
+    }
+    }
+
+    return nullptr;
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <sstream>
 
+#include "acorn/statistics.h"
 #include "acorn/typesystem/types.h"
 #include "acorn/ast/visitor.h"
 
@@ -12,8 +13,12 @@ using namespace acorn::ast;
 using std::make_unique;
 using std::unique_ptr;
 
+static statistics::Counter node_count("ast_nodes", "AST nodes created");
+
 Node::Node(NodeKind kind, Token token)
-    : m_kind(std::move(kind)), m_token(std::move(token)), m_type(nullptr) { }
+    : m_kind(std::move(kind)), m_token(std::move(token)), m_type(nullptr) {
+    ++node_count;
+}
 
 std::string Node::to_string() const {
     std::stringstream ss;
@@ -61,6 +66,8 @@ const char *Node::kind_string() const {
         return "Assignment";
     case NK_While:
         return "While";
+    case NK_For:
+        return "For";
     case NK_If:
         return "If";
     case NK_Return:
@@ -244,7 +251,7 @@ CCall::CCall(Token token, std::unique_ptr<Name> name, std::vector<std::unique_pt
 Cast::Cast(Token token, std::unique_ptr<Node> operand, std::unique_ptr<TypeName> new_type)
     : Node(NK_Cast, token), m_operand(std::move(operand)), m_new_type(std::move(new_type)) { }
 
-Assignment::Assignment(Token token, std::unique_ptr<VarDecl> lhs, std::unique_ptr<Node> rhs)
+Assignment::Assignment(Token token, std::unique_ptr<Node> lhs, std::unique_ptr<Node> rhs)
     : Node(NK_Assignment, token), m_lhs(std::move(lhs)), m_rhs(std::move(rhs)) { }
 
 Selector::Selector(Token token, std::unique_ptr<Node> operand, std::unique_ptr<ParamName> field)
@@ -256,6 +263,9 @@ Selector::Selector(Token token, std::unique_ptr<Node> operand, std::string field
 While::While(Token token, std::unique_ptr<Node> condition, std::unique_ptr<Node> body)
     : Node(NK_While, token), m_condition(std::move(condition)), m_body(std::move(body)) { }
 
+For::For(Token token, std::unique_ptr<VarDecl> variable, std::unique_ptr<Node> iterable, std::unique_ptr<Node> body)
+    : Node(NK_For, token), m_variable(std::move(variable)), m_iterable(std::move(iterable)), m_body(std::move(body)) { }
+
 If::If(Token token, std::unique_ptr<Node> condition, std::unique_ptr<Node> true_case, std::unique_ptr<Node> false_case)
     : Node(NK_If, token), m_condition(std::move(condition)), m_true_case(std::move(true_case)), m_false_case(std::move(false_case)) { }
 
@@ -60,6 +60,8 @@ void Visitor::visit_node(Node *node) {
         visit_selector(selector);
     } else if (auto while_ = llvm::dyn_cast<While>(node)) {
         visit_while(while_);
+    } else if (auto for_ = llvm::dyn_cast<For>(node)) {
+        visit_for(for_);
     } else if (auto if_ = llvm::dyn_cast<If>(node)) {
         visit_if(if_);
     } else if (auto return_ = llvm::dyn_cast<Return>(node)) {
@@ -223,6 +225,12 @@ void Visitor::visit_while(While *node) {
     visit_node(node->body());
 }
 
+void Visitor::visit_for(For *node) {
+    visit_node(node->iterable());
+    visit_node(node->variable());
+    visit_node(node->body());
+}
+
 void Visitor::visit_if(If *node) {
     visit_node(node->condition());
 
@@ -0,0 +1,145 @@
+#include <cstdint>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "acorn/cache.h"
+
+using namespace acorn;
+using namespace acorn::cache;
+
+void KeyBuilder::add(llvm::StringRef data) {
+    // length prefix every field, so ("ab", "c") and ("a", "bc") hash differently
+    uint64_t size = data.size();
+    m_sha1.update(llvm::StringRef(reinterpret_cast<const char *>(&size), sizeof(size)));
+    m_sha1.update(data);
+}
+
+bool KeyBuilder::add_file(const std::string &filename) {
+    auto buffer = llvm::MemoryBuffer::getFile(filename);
+    if (!buffer) {
+        return false;
+    }
+
+    add(filename);
+    add((*buffer)->getBuffer());
+
+    return true;
+}
+
+std::string KeyBuilder::key() {
+    return llvm::toHex(m_sha1.final(), true);
+}
+
+Cache::Cache(std::string directory) : m_logger("acorn.cache"), m_directory(directory) {
+
+}
+
+bool Cache::restore(const std::string &key, const std::string &output_name) {
+    auto entry_path = get_entry_path(key);
+
+    if (!llvm::sys::fs::exists(entry_path)) {
+        m_logger.debug("cache miss for {}", key);
+        return false;
+    }
+
+    if (auto error_code = llvm::sys::fs::copy_file(entry_path, output_name)) {
+        m_logger.warn("unable to restore {} from the cache: {}", output_name, error_code.message());
+        return false;
+    }
+
+    llvm::sys::fs::setPermissions(output_name, llvm::sys::fs::all_read | llvm::sys::fs::all_exe | llvm::sys::fs::owner_write);
+
+    m_logger.info("cache hit for {}", key);
+
+    return true;
+}
+
+void Cache::store(const std::string &key, const std::string &output_name) {
+    int temporary_fd;
+    llvm::SmallString<128> temporary_path;
+    if (!create_temporary_entry(key, temporary_fd, temporary_path)) {
+        return;
+    }
+
+    llvm::sys::Process::SafelyCloseFileDescriptor(temporary_fd);
+
+    auto error_code = llvm::sys::fs::copy_file(output_name, temporary_path);
+    if (!error_code) {
+        error_code = llvm::sys::fs::rename(temporary_path, get_entry_path(key));
+    }
+
+    if (error_code) {
+        m_logger.warn("unable to store {} in the cache: {}", output_name, error_code.message());
+        llvm::sys::fs::remove(temporary_path);
+        return;
+    }
+
+    m_logger.debug("stored {} in the cache as {}", output_name, key);
+}
+
+bool Cache::load_object(const std::string &key, llvm::SmallVectorImpl<char> &object) {
+    auto buffer = llvm::MemoryBuffer::getFile(get_entry_path(key));
+    if (!buffer) {
+        return false;
+    }
+
+    auto contents = (*buffer)->getBuffer();
+    object.assign(contents.begin(), contents.end());
+
+    return true;
+}
+
+void Cache::store_object(const std::string &key, llvm::ArrayRef<char> object) {
+    int temporary_fd;
+    llvm::SmallString<128> temporary_path;
+    if (!create_temporary_entry(key, temporary_fd, temporary_path)) {
+        return;
+    }
+
+    {
+        llvm::raw_fd_ostream temporary_file(temporary_fd, true);
+        temporary_file.write(object.data(), object.size());
+    }
+
+    if (auto error_code = llvm::sys::fs::rename(temporary_path, get_entry_path(key))) {
+        m_logger.warn("unable to store object {} in the cache: {}", key, error_code.message());
+        llvm::sys::fs::remove(temporary_path);
+    }
+}
+
+bool Cache::create_temporary_entry(const std::string &key, int &fd, llvm::SmallVectorImpl<char> &path) {
+    auto entry_directory = get_entry_directory(key);
+    if (auto error_code = llvm::sys::fs::create_directories(entry_directory)) {
+        m_logger.warn("unable to create cache directory {}: {}", entry_directory, error_code.message());
+        return false;
+    }
+
+    // entries are written to a unique name and renamed, so concurrent compiles never see a partial one
+    llvm::SmallString<128> model(entry_directory);
+    llvm::sys::path::append(model, key + ".%%%%%%.tmp");
+
+    if (auto error_code = llvm::sys::fs::createUniqueFile(model, fd, path)) {
+        m_logger.warn("unable to create a cache entry: {}", error_code.message());
+        return false;
+    }
+
+    return true;
+}
+
+std::string Cache::get_entry_directory(const std::string &key) const {
+    llvm::SmallString<128> path(m_directory);
+    llvm::sys::path::append(path, key.substr(0, 2));
+    return path.str().str();
+}
+
+std::string Cache::get_entry_path(const std::string &key) const {
+    llvm::SmallString<128> path(get_entry_directory(key));
+    llvm::sys::path::append(path, key.substr(2));
+    return path.str().str();
+}
@@ -10,6 +10,7 @@
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/MD5.h>
 #include <llvm/Transforms/Scalar.h>
 #include <llvm/Transforms/IPO.h>
 
@@ -27,8 +28,8 @@ using namespace acorn;
 using namespace acorn::codegen;
 using namespace acorn::diagnostics;
 
-CodeGenerator::CodeGenerator(symboltable::Namespace *scope, llvm::DataLayout *data_layout)
-    : ast::Visitor("acorn.codegen"), IrBuilder(m_context), m_module(nullptr) {
+CodeGenerator::CodeGenerator(llvm::LLVMContext &context, symboltable::Namespace *scope, llvm::DataLayout *data_layout)
+    : ast::Visitor("acorn.codegen"), IrBuilder(context), m_context(context), m_module(nullptr) {
     push_scope(scope);
 
     m_md_builder = std::make_unique<llvm::MDBuilder>(m_context);
@@ -104,6 +105,81 @@ typesystem::Type *CodeGenerator::get_replacement_type_parameter(typesystem::Para
     return get_replacement_type_parameter(key->type());
 }
 
+typesystem::Type *CodeGenerator::replace_type_parameters(typesystem::Type *type) {
+    auto parameter = dynamic_cast<typesystem::Parameter *>(type);
+    if (parameter != nullptr) {
+        auto it = m_replacement_type_parameters.find(parameter->type());
+        if (it == m_replacement_type_parameters.end()) {
+            return nullptr;
+        }
+
+        return it->second;
+    }
+
+    auto parameters = type->parameters();
+    if (parameters.empty()) {
+        return type;
+    }
+
+    for (auto &p : parameters) {
+        p = replace_type_parameters(p);
+        return_null_if_null(p);
+    }
+
+    return type->with_parameters(parameters);
+}
+
+static bool is_abstract_specialisation(const std::map<typesystem::ParameterType *, typesystem::Type *> &specialisation) {
+    for (auto &entry : specialisation) {
+        if (entry.second->is_abstract()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int CodeGenerator::get_concrete_specialisation_index(typesystem::Method *method, int specialisation_index) {
+    auto &specialisations = method->generic_specialisations();
+    if (!is_abstract_specialisation(specialisations[specialisation_index])) {
+        return specialisation_index;
+    }
+
+    // a call inside a generic method was checked against that method's own parameters, so
+    // it's only known what it calls once they're replaced with the ones being generated
+    std::map<typesystem::ParameterType *, typesystem::Type *> concrete;
+    for (auto &entry : specialisations[specialisation_index]) {
+        auto type = replace_type_parameters(entry.second);
+        if (type == nullptr) {
+            return -1;
+        }
+
+        concrete[entry.first] = type;
+    }
+
+    for (size_t i = 0; i < specialisations.size(); i++) {
+        if (specialisations[i].size() != concrete.size() || is_abstract_specialisation(specialisations[i])) {
+            continue;
+        }
+
+        bool same = true;
+        for (auto &entry : specialisations[i]) {
+            auto it = concrete.find(entry.first);
+            if (it == concrete.end() || it->second->mangled_name() != entry.second->mangled_name()) {
+                same = false;
+                break;
+            }
+        }
+
+        if (same) {
+            return static_cast<int>(i);
+        }
+    }
+
+    method->add_generic_specialisation(concrete);
+    return static_cast<int>(specialisations.size()) - 1;
+}
+
 void CodeGenerator::push_llvm_type_and_initialiser(llvm::Type *type, llvm::Constant *initialiser) {
     push_llvm_type(type);
     push_llvm_initialiser(initialiser);
@@ -135,6 +211,141 @@ llvm::Function *CodeGenerator::create_function(llvm::Type *type, std::string nam
     );
 }
 
+llvm::Function *CodeGenerator::get_specialised_function(typesystem::Method *method, int specialisation_index) {
+    auto key = std::make_pair(method, specialisation_index);
+
+    auto it = m_specialised_functions.find(key);
+    if (it != m_specialised_functions.end()) {
+        return it->second;
+    }
+
+    // declare the function now, so calls can come before the definition is generated
+    auto definition = m_reachability.definition_of(method);
+    return_null_if_null(definition);
+
+    auto llvm_method_type = llvm::cast<llvm::StructType>(generate_type(method));
+    auto llvm_specialised_method_type = llvm::cast<llvm::PointerType>(llvm_method_type->getElementType(specialisation_index))->getElementType();
+
+    auto function = create_function(
+        llvm_specialised_method_type,
+        codegen::mangle_method(definition->name()->name()->value(), method)
+    );
+
+    m_specialised_functions[key] = function;
+
+    return function;
+}
+
+llvm::Function *CodeGenerator::generate_specialised_function(ast::DefDecl *node, symboltable::Symbol *symbol, int specialisation_index) {
+    auto method = static_cast<typesystem::Method *>(node->type());
+
+    auto function = get_specialised_function(method, specialisation_index);
+    return_null_if_null(function);
+
+    m_queued_specialisations.insert(std::make_pair(method, specialisation_index));
+
+    auto &specialisation = method->generic_specialisations()[specialisation_index];
+    push_replacement_generic_specialisation(specialisation);
+
+    push_scope(symbol);
+    push_insert_point();
+
+    create_entry_basic_block(function, true);
+    prepare_method_parameters(node, function);
+
+    if (node->builtin()) {
+        generate_builtin_method_body(node, function);
+    } else {
+        visit_node(node->body().get());
+    }
+
+    auto value = pop_llvm_value();
+
+    if (value != nullptr) {
+        // whatever a Void method's body ends with, it gives nothing back
+        if (dynamic_cast<typesystem::Void *>(method->return_type()) != nullptr) {
+            value = m_ir_builder->getInt1(false);
+        }
+
+        m_ir_builder->CreateRet(value);
+    }
+
+    pop_insert_point();
+    pop_scope();
+
+    pop_replacement_generic_specialisation(specialisation);
+
+    if (value == nullptr || !verify_function(node, function)) {
+        return nullptr;
+    }
+
+    // FIXME return something better, like a load to the GEP pointer
+    symbol->set_llvm_value(function);
+
+    return function;
+}
+
+void CodeGenerator::generate_pending_specialised_functions() {
+    while (!m_pending_specialisations.empty()) {
+        auto key = m_pending_specialisations.front();
+        m_pending_specialisations.pop_front();
+
+        auto definition = m_reachability.definition_of(key.first);
+        auto symbol = m_method_symbols[key.first];
+        if (definition == nullptr || symbol == nullptr) {
+            m_logger.critical("No definition to generate a specialisation from");
+            continue;
+        }
+
+        generate_specialised_function(definition, symbol, key.second);
+    }
+}
+
+bool CodeGenerator::generate_definition(ast::DefDecl *node) {
+    auto function_symbol = scope()->lookup(this, node->name());
+    auto function_type = static_cast<typesystem::Function *>(function_symbol->type());
+
+    // the method table is only needed when the function is used as a value
+    bool escaping = m_reachability.is_escaping(function_type);
+
+    if (escaping && !function_symbol->has_llvm_value()) {
+        auto llvm_function_type = generate_type(function_type);
+        auto llvm_initialiser = take_initialiser();
+
+        auto variable = create_global_variable(
+            llvm_function_type, llvm_initialiser,
+            node->name()->name()->value()
+        );
+        return_false_if_null(variable);
+
+        function_symbol->set_llvm_value(variable);
+    }
+
+    auto method = static_cast<typesystem::Method *>(node->type());
+
+    auto symbol = function_symbol->scope()->lookup_by_node(this, node);
+    m_method_symbols[method] = symbol;
+
+    for (int specialisation_index = 0; specialisation_index < static_cast<int>(method->no_generic_specialisation()); specialisation_index++) {
+        if (!m_reachability.is_reachable(method, specialisation_index) ||
+                is_abstract_specialisation(method->generic_specialisations()[specialisation_index])) {
+            continue;
+        }
+
+        auto function = generate_specialised_function(node, symbol, specialisation_index);
+        return_false_if_null(function);
+
+        if (escaping) {
+            int llvm_method_index = function_type->get_llvm_index(method);
+            create_store_method_to_function(
+                function, function_symbol->llvm_value(), llvm_method_index, specialisation_index
+            );
+        }
+    }
+
+    return true;
+}
+
 llvm::GlobalVariable *CodeGenerator::create_global_variable(llvm::Type *type, llvm::Constant *initialiser, std::string name) {
     return_null_if_null(type);
     return_null_if_null(initialiser);
@@ -149,9 +360,67 @@ llvm::GlobalVariable *CodeGenerator::create_global_variable(llvm::Type *type, ll
         llvm::GlobalValue::DefaultVisibility
     );
 
+    m_global_variables.push_back(variable);
+
     return variable;
 }
 
+llvm::Constant *CodeGenerator::get_runtime_function(std::string name, llvm::FunctionType *type) {
+    return m_module->getOrInsertFunction(name, type);
+}
+
+llvm::Constant *CodeGenerator::get_string_literal(std::string value) {
+    auto it = m_string_literals.find(value);
+    if (it != m_string_literals.end()) {
+        return it->second;
+    }
+
+    // null terminated so the bytes can go straight to C, though the length doesn't count it
+    auto initialiser = llvm::ConstantDataArray::getString(m_context, value, true);
+
+    // named after its contents rather than how many came before, so adding a string elsewhere
+    // doesn't change the IR of every function using a later one
+    llvm::MD5 md5;
+    md5.update(value);
+    llvm::MD5::MD5Result digest;
+    md5.final(digest);
+    llvm::SmallString<32> hex;
+    llvm::MD5::stringifyResult(digest, hex);
+
+    // read only and never on the collected heap, so the collector doesn't need to know about it
+    auto variable = new llvm::GlobalVariable(
+        *m_module, initialiser->getType(), true,
+        llvm::GlobalValue::PrivateLinkage, initialiser, ".str." + hex.str().substr(0, 16)
+    );
+    variable->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+    auto bytes = llvm::ConstantExpr::getInBoundsGetElementPtr(
+        initialiser->getType(), variable,
+        llvm::ArrayRef<llvm::Constant *>({ m_ir_builder->getInt64(0), m_ir_builder->getInt64(0) })
+    );
+
+    m_string_literals[value] = bytes;
+
+    return bytes;
+}
+
+void CodeGenerator::generate_runtime_initialisation() {
+    auto void_function_type = llvm::FunctionType::get(m_ir_builder->getVoidTy(), false);
+    m_ir_builder->CreateCall(get_runtime_function("acorn_gc_initialise", void_function_type));
+
+    auto add_root_function_type = llvm::FunctionType::get(
+        m_ir_builder->getVoidTy(), { m_ir_builder->getInt8PtrTy(), m_ir_builder->getInt64Ty() }, false
+    );
+    auto add_root_function = get_runtime_function("acorn_gc_add_root", add_root_function_type);
+
+    // globals aren't on any stack, so the collector has to be told about them
+    for (auto variable : m_global_variables) {
+        auto size = m_data_layout->getTypeAllocSize(variable->getValueType());
+        auto start = m_ir_builder->CreateBitCast(variable, m_ir_builder->getInt8PtrTy());
+        m_ir_builder->CreateCall(add_root_function, { start, m_ir_builder->getInt64(size) });
+    }
+}
+
 void CodeGenerator::prepare_method_parameters(ast::DefDecl *node, llvm::Function *function) {
     auto name = node->name();
 
@@ -190,64 +459,269 @@ llvm::Value *CodeGenerator::generate_builtin_variable(ast::VarDecl *node) {
         return m_ir_builder->getInt1(1);
     } else if (name == "false") {
         return m_ir_builder->getInt1(0);
+    } else if (name == "nil") {
+        // Void is represented as false
+        return m_ir_builder->getInt1(0);
     }
 
     m_logger.critical("Unknown builtin variable: {}", name);
     return nullptr;
 }
 
-void CodeGenerator::generate_builtin_method_body(ast::DefDecl *node, llvm::Function *function) {
+llvm::Value *CodeGenerator::generate_builtin_method_call(ast::DefDecl *node, ast::Call *call, std::vector<llvm::Value *> arguments, llvm::Type *return_type, typesystem::Type *type) {
     auto name = node->name()->name()->value();
+    auto method = static_cast<typesystem::Method *>(node->type());
+
+    if (arguments.empty()) {
+        m_logger.critical("Builtin definition without arguments: {}", name);
+        return nullptr;
+    }
 
-    if (name == "*") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateMul(a_value, b_value, "multiplication"));
+    bool is_float = arguments[0]->getType()->isFloatingPointTy();
+    bool is_unsigned = dynamic_cast<typesystem::UnsignedInteger *>(method->parameter_types()[0]) != nullptr;
+    bool is_dictionary = dynamic_cast<typesystem::Dictionary *>(method->parameter_types()[0]) != nullptr;
+
+    if (is_dictionary) {
+        return generate_dictionary_method_call(name, arguments, return_type);
+    } else if (name == "*") {
+        if (is_float) {
+            return m_ir_builder->CreateFMul(arguments[0], arguments[1], "multiplication");
+        } else {
+            return m_ir_builder->CreateMul(arguments[0], arguments[1], "multiplication");
+        }
     } else if (name == "+") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        if (a_value->getType()->isFloatingPointTy()) {
-            push_llvm_value(m_ir_builder->CreateFAdd(a_value, b_value, "addition"));
+        if (is_float) {
+            return m_ir_builder->CreateFAdd(arguments[0], arguments[1], "addition");
         } else {
-            push_llvm_value(m_ir_builder->CreateAdd(a_value, b_value, "addition"));
+            return m_ir_builder->CreateAdd(arguments[0], arguments[1], "addition");
         }
     } else if (name == "-") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateSub(a_value, b_value, "subtraction"));
+        if (is_float) {
+            return m_ir_builder->CreateFSub(arguments[0], arguments[1], "subtraction");
+        } else {
+            return m_ir_builder->CreateSub(arguments[0], arguments[1], "subtraction");
+        }
     } else if (name == "==") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateICmpEQ(a_value, b_value, "eq"));
+        if (is_float) {
+            return m_ir_builder->CreateFCmpOEQ(arguments[0], arguments[1], "eq");
+        } else {
+            return m_ir_builder->CreateICmpEQ(arguments[0], arguments[1], "eq");
+        }
     } else if (name == "!=") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateICmpNE(a_value, b_value, "neq"));
+        if (is_float) {
+            return m_ir_builder->CreateFCmpONE(arguments[0], arguments[1], "neq");
+        } else {
+            return m_ir_builder->CreateICmpNE(arguments[0], arguments[1], "neq");
+        }
     } else if (name == "<") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateICmpSLT(a_value, b_value, "lt"));
+        if (is_float) {
+            return m_ir_builder->CreateFCmpOLT(arguments[0], arguments[1], "lt");
+        } else if (is_unsigned) {
+            return m_ir_builder->CreateICmpULT(arguments[0], arguments[1], "lt");
+        } else {
+            return m_ir_builder->CreateICmpSLT(arguments[0], arguments[1], "lt");
+        }
     } else if (name == ">") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateICmpSGT(a_value, b_value, "gt"));
+        if (is_float) {
+            return m_ir_builder->CreateFCmpOGT(arguments[0], arguments[1], "gt");
+        } else if (is_unsigned) {
+            return m_ir_builder->CreateICmpUGT(arguments[0], arguments[1], "gt");
+        } else {
+            return m_ir_builder->CreateICmpSGT(arguments[0], arguments[1], "gt");
+        }
     } else if (name == ">=") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateICmpSGE(a_value, b_value, "gte"));
+        if (is_float) {
+            return m_ir_builder->CreateFCmpOGE(arguments[0], arguments[1], "gte");
+        } else if (is_unsigned) {
+            return m_ir_builder->CreateICmpUGE(arguments[0], arguments[1], "gte");
+        } else {
+            return m_ir_builder->CreateICmpSGE(arguments[0], arguments[1], "gte");
+        }
     } else if (name == "<=") {
-        auto a_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "a")->llvm_value());
-        auto b_value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "b")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateICmpSLE(a_value, b_value, "lte"));
+        if (is_float) {
+            return m_ir_builder->CreateFCmpOLE(arguments[0], arguments[1], "lte");
+        } else if (is_unsigned) {
+            return m_ir_builder->CreateICmpULE(arguments[0], arguments[1], "lte");
+        } else {
+            return m_ir_builder->CreateICmpSLE(arguments[0], arguments[1], "lte");
+        }
     } else if (name == "to_float") {
-        auto value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "self")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateSIToFP(value, function->getReturnType(), "float"));
+        if (is_unsigned) {
+            return m_ir_builder->CreateUIToFP(arguments[0], return_type, "float");
+        } else {
+            return m_ir_builder->CreateSIToFP(arguments[0], return_type, "float");
+        }
     } else if (name == "to_int") {
-        auto value = m_ir_builder->CreateLoad(scope()->lookup(this, node, "self")->llvm_value());
-        push_llvm_value(m_ir_builder->CreateFPToSI(value, function->getReturnType(), "int"));
+        if (is_float) {
+            return m_ir_builder->CreateFPToSI(arguments[0], return_type, "int");
+        } else {
+            return m_ir_builder->CreateIntCast(arguments[0], return_type, !is_unsigned, "int");
+        }
+    } else if (name == "getindex") {
+        auto element = m_ir_builder->CreateInBoundsGEP(arguments[0], arguments[1], "element");
+        return m_ir_builder->CreateLoad(element);
+    } else if (name == "setindex") {
+        auto element = m_ir_builder->CreateInBoundsGEP(arguments[0], arguments[1], "element");
+        m_ir_builder->CreateStore(arguments[2], element);
+        return llvm::Constant::getNullValue(return_type);
+    } else if (name == "offset") {
+        return m_ir_builder->CreateInBoundsGEP(arguments[0], arguments[1], "offset");
+    } else if (name == "is_null") {
+        return m_ir_builder->CreateIsNull(arguments[0], "is_null");
+    } else if (name == "check_bounds") {
+        return generate_bounds_check(arguments[0], arguments[1]);
+    } else if (name == "join") {
+        auto join_type = llvm::FunctionType::get(
+            m_ir_builder->getInt8PtrTy(), { m_ir_builder->getInt8PtrTy() }, false
+        );
+        auto frame = m_ir_builder->CreateCall(get_runtime_function("acorn_task_join", join_type), { arguments[0] }, "frame");
+
+        // the result is always the first thing in a task's frame
+        auto result = m_ir_builder->CreateBitCast(frame, llvm::PointerType::getUnqual(return_type));
+        return m_ir_builder->CreateLoad(result, "result");
+    } else if (name == "new_dictionary") {
+        auto dictionary_type = dynamic_cast<typesystem::Dictionary *>(type);
+        if (dictionary_type == nullptr) {
+            m_logger.critical("new_dictionary without a dictionary type");
+            return nullptr;
+        }
+
+        auto create_type = llvm::FunctionType::get(
+            m_ir_builder->getInt8PtrTy(), std::vector<llvm::Type *>(4, m_ir_builder->getInt64Ty()), false
+        );
+
+        auto layout = generate_dictionary_layout(node, dictionary_type);
+        layout.insert(layout.begin(), m_ir_builder->getInt64(0));
+
+        return m_ir_builder->CreateCall(get_runtime_function("acorn_dictionary_create", create_type), layout, "dictionary");
+    } else if (name == "strideof") {
+        // only the type it was called with matters, and that's only known at the call
+        if (call == nullptr || call->inferred_type_parameters().size() != 1) {
+            m_logger.critical("strideof without a type to measure");
+            return nullptr;
+        }
+
+        auto measured_type = generate_type(call->inferred_type_parameters().begin()->second);
+        return_null_if_null(measured_type);
+
+        return m_ir_builder->getInt64(m_data_layout->getTypeAllocSize(measured_type));
+    } else if (name == "zero") {
+        return llvm::Constant::getNullValue(return_type);
+    } else {
+        m_logger.critical("Unknown builtin definition: {}", name);
+        return nullptr;
+    }
+}
+
+llvm::Value *CodeGenerator::generate_dictionary_method_call(std::string name, std::vector<llvm::Value *> arguments, llvm::Type *return_type) {
+    auto int8_pointer_type = m_ir_builder->getInt8PtrTy();
+    auto int64_type = m_ir_builder->getInt64Ty();
+
+    if (name == "length") {
+        auto length_type = llvm::FunctionType::get(int64_type, { int8_pointer_type }, false);
+        return m_ir_builder->CreateCall(get_runtime_function("acorn_dictionary_length", length_type), { arguments[0] }, "length");
+    }
+
+    if (arguments.size() < 2) {
+        m_logger.critical("Unknown builtin dictionary definition: {}", name);
+        return nullptr;
+    }
+
+    // the runtime takes keys by address, and it only reads them for the length of the call
+    auto key = create_entry_block_alloca(arguments[1]->getType(), "key");
+    m_ir_builder->CreateLifetimeStart(key);
+    m_ir_builder->CreateStore(arguments[1], key);
+
+    std::vector<llvm::Value *> runtime_arguments = {
+        arguments[0], m_ir_builder->CreateBitCast(key, int8_pointer_type)
+    };
+
+    auto slot_function_type = llvm::FunctionType::get(int8_pointer_type, { int8_pointer_type, int8_pointer_type }, false);
+
+    llvm::Value *result = nullptr;
+
+    if (name == "getindex") {
+        auto slot = m_ir_builder->CreateCall(get_runtime_function("acorn_dictionary_lookup", slot_function_type), runtime_arguments);
+        auto value = m_ir_builder->CreateBitCast(slot, llvm::PointerType::getUnqual(return_type));
+        result = m_ir_builder->CreateLoad(value, "value");
+    } else if (name == "setindex") {
+        auto slot = m_ir_builder->CreateCall(get_runtime_function("acorn_dictionary_insert", slot_function_type), runtime_arguments);
+        auto value = m_ir_builder->CreateBitCast(slot, llvm::PointerType::getUnqual(arguments[2]->getType()));
+        m_ir_builder->CreateStore(arguments[2], value);
+        result = llvm::Constant::getNullValue(return_type);
+    } else if (name == "contains") {
+        auto slot = m_ir_builder->CreateCall(get_runtime_function("acorn_dictionary_find", slot_function_type), runtime_arguments);
+        result = m_ir_builder->CreateIsNotNull(slot, "contains");
+    } else if (name == "remove") {
+        auto remove_type = llvm::FunctionType::get(int64_type, { int8_pointer_type, int8_pointer_type }, false);
+        auto removed = m_ir_builder->CreateCall(get_runtime_function("acorn_dictionary_remove", remove_type), runtime_arguments);
+        result = m_ir_builder->CreateICmpNE(removed, m_ir_builder->getInt64(0), "removed");
     } else {
-        m_logger.critical("Unknown builtin definition.");
+        m_logger.critical("Unknown builtin dictionary definition: {}", name);
+    }
+
+    m_ir_builder->CreateLifetimeEnd(key);
+
+    return result;
+}
+
+std::vector<llvm::Value *> CodeGenerator::generate_dictionary_layout(ast::Node *node, typesystem::Dictionary *type) {
+    auto key_type = generate_type(type->key_type());
+    auto value_type = generate_type(type->value_type());
+
+    // strings are compared by their contents rather than by where they point
+    int key_kind = 0;
+    auto string_symbol = scope()->lookup(this, node, "String");
+    auto string_type = string_symbol ? dynamic_cast<typesystem::TypeType *>(string_symbol->type()) : nullptr;
+    if (string_type != nullptr && string_type->create(this, node)->is_compatible(type->key_type())) {
+        key_kind = 1;
     }
+
+    return {
+        m_ir_builder->getInt64(m_data_layout->getTypeAllocSize(key_type)),
+        m_ir_builder->getInt64(m_data_layout->getTypeAllocSize(value_type)),
+        m_ir_builder->getInt64(key_kind)
+    };
+}
+
+llvm::Value *CodeGenerator::generate_bounds_check(llvm::Value *index, llvm::Value *length) {
+    auto in_bounds_bb = create_basic_block("in_bounds");
+    auto out_of_bounds_bb = create_basic_block("out_of_bounds");
+
+    // one unsigned comparison also catches negative indexes, and is the form LLVM knows how
+    // to hoist out of a loop or drop when the loop condition already implies it
+    auto in_bounds = m_ir_builder->CreateICmpULT(index, length, "in_bounds");
+    m_ir_builder->CreateCondBr(
+        in_bounds, in_bounds_bb, out_of_bounds_bb,
+        m_md_builder->createBranchWeights(1 << 20, 1)
+    );
+
+    m_ir_builder->SetInsertPoint(out_of_bounds_bb);
+
+    auto bounds_error_type = llvm::FunctionType::get(
+        m_ir_builder->getVoidTy(), { m_ir_builder->getInt64Ty(), m_ir_builder->getInt64Ty() }, false
+    );
+    auto bounds_error = llvm::cast<llvm::Function>(get_runtime_function("acorn_bounds_error", bounds_error_type));
+    bounds_error->setDoesNotReturn();
+    bounds_error->addFnAttr(llvm::Attribute::Cold);
+
+    m_ir_builder->CreateCall(bounds_error, { index, length });
+    m_ir_builder->CreateUnreachable();
+
+    m_ir_builder->SetInsertPoint(in_bounds_bb);
+
+    return index;
+}
+
+void CodeGenerator::generate_builtin_method_body(ast::DefDecl *node, llvm::Function *function) {
+    std::vector<llvm::Value *> arguments;
+    for (auto &parameter : node->parameters()) {
+        auto symbol = scope()->lookup(this, node, parameter->name()->value());
+        arguments.push_back(m_ir_builder->CreateLoad(symbol->llvm_value()));
+    }
+
+    auto method = static_cast<typesystem::Method *>(node->type());
+    push_llvm_value(generate_builtin_method_call(node, nullptr, arguments, function->getReturnType(), method->return_type()));
 }
 
 llvm::Value *CodeGenerator::generate_llvm_value(ast::Node *node) {
@@ -318,6 +792,14 @@ void CodeGenerator::visit(typesystem::UnsafePointerType *type) {
     visit_constructor(type);
 }
 
+void CodeGenerator::visit(typesystem::TaskType *type) {
+    visit_constructor(type);
+}
+
+void CodeGenerator::visit(typesystem::DictionaryType *type) {
+    visit_constructor(type);
+}
+
 void CodeGenerator::visit(typesystem::FunctionType *type) {
     visit_constructor(type);
 }
@@ -429,6 +911,20 @@ void CodeGenerator::visit(typesystem::UnsafePointer *type) {
     push_llvm_initialiser(llvm::ConstantPointerNull::get(llvm_pointer_type));
 }
 
+void CodeGenerator::visit(typesystem::Task *type) {
+    // the scheduler's handle, which is opaque to generated code
+    auto llvm_pointer_type = m_ir_builder->getInt8PtrTy();
+    push_llvm_type(llvm_pointer_type);
+    push_llvm_initialiser(llvm::ConstantPointerNull::get(llvm_pointer_type));
+}
+
+void CodeGenerator::visit(typesystem::Dictionary *type) {
+    // the runtime's hash table, which is opaque to generated code
+    auto llvm_pointer_type = m_ir_builder->getInt8PtrTy();
+    push_llvm_type(llvm_pointer_type);
+    push_llvm_initialiser(llvm::ConstantPointerNull::get(llvm_pointer_type));
+}
+
 void CodeGenerator::visit(typesystem::Record *type) {
     std::vector<llvm::Type *> llvm_types;
     std::vector<llvm::Constant *> llvm_initialisers;
@@ -462,6 +958,15 @@ void CodeGenerator::visit(typesystem::Method *type) {
     std::vector<llvm::Constant *> specialised_method_initialisers;
 
     for (auto specialisation : type->generic_specialisations()) {
+        // calls inside generic methods are checked against their parameters, and those
+        // specialisations are only ever generated once replaced with concrete ones
+        if (is_abstract_specialisation(specialisation)) {
+            auto placeholder = m_ir_builder->getInt8PtrTy();
+            specialised_method_types.push_back(placeholder);
+            specialised_method_initialisers.push_back(llvm::ConstantPointerNull::get(placeholder));
+            continue;
+        }
+
         push_replacement_generic_specialisation(specialisation);
         auto llvm_type = generate_function_type_for_method(type);
         if (llvm_type == nullptr) {
@@ -504,12 +1009,29 @@ void CodeGenerator::visit(typesystem::Function *type) {
 
 void CodeGenerator::visit_block(ast::Block *node) {
     llvm::Value *last_value = nullptr;
+    bool has_definitions = false;
 
     for (auto &expression : node->expressions()) {
+        // the type checker never lets a definition's value be used, so it's generated as a statement
+        if (auto def_decl = llvm::dyn_cast<ast::DefDecl>(expression)) {
+            if (!generate_definition(def_decl)) {
+                push_llvm_value(nullptr);
+                return;
+            }
+
+            has_definitions = true;
+            continue;
+        }
+
         last_value = generate_llvm_value(expression);
         return_and_push_null_if_null(last_value);
     }
 
+    // a block of nothing but definitions is Void
+    if (last_value == nullptr && has_definitions) {
+        last_value = m_ir_builder->getInt1(false);
+    }
+
     push_llvm_value(last_value);
 }
 
@@ -543,10 +1065,7 @@ void CodeGenerator::visit_var_decl(ast::VarDecl *node) {
 
         m_ir_builder->SetInsertPoint(&m_init_variables_function->getEntryBlock());
     } else {
-        auto insert_function = m_ir_builder->GetInsertBlock()->getParent();
-        m_ir_builder->SetInsertPoint(&insert_function->getEntryBlock().front());
-
-        symbol->set_llvm_value(m_ir_builder->CreateAlloca(llvm_type, 0, node->name()->name()->value()));
+        symbol->set_llvm_value(create_entry_block_alloca(llvm_type, node->name()->name()->value()));
     }
 
     pop_insert_point();
@@ -582,8 +1101,26 @@ void CodeGenerator::visit_complex(ast::Complex *node) {
 }
 
 void CodeGenerator::visit_string(ast::String *node) {
-    m_logger.warn("Visit ast::String not yet implemented.");
-    push_llvm_value(nullptr);
+    auto llvm_type = llvm::dyn_cast_or_null<llvm::StructType>(generate_type(node));
+    return_and_push_null_if_null(llvm_type);
+
+    auto record = dynamic_cast<typesystem::Record *>(node->type());
+    if (record == nullptr || !record->has_field("bytes") || !record->has_field("length")) {
+        m_logger.critical("String literals need String to be a record of bytes and length.");
+        push_llvm_value(nullptr);
+        return;
+    }
+
+    auto value = node->value();
+
+    // a literal is entirely constant: the bytes are shared by every use of the same text
+    std::vector<llvm::Constant *> fields(llvm_type->getNumElements());
+    fields[record->get_field_index("bytes")] = llvm::ConstantExpr::getPointerCast(
+        get_string_literal(value), llvm_type->getElementType(record->get_field_index("bytes"))
+    );
+    fields[record->get_field_index("length")] = m_ir_builder->getInt64(value.size());
+
+    push_llvm_value(llvm::ConstantStruct::get(llvm_type, fields));
 }
 
 void CodeGenerator::visit_list(ast::List *node) {
@@ -595,39 +1132,54 @@ void CodeGenerator::visit_list(ast::List *node) {
         elements.push_back(value);
     }
 
-    auto type = static_cast<llvm::StructType *>(generate_type(node));
-    return_and_push_null_if_null(type);
-
-    auto length_type = type->elements()[0];
-    auto element_type = type->elements()[1];
+    auto record = static_cast<typesystem::Record *>(node->type());
 
-    // assign length
-    auto instance = m_ir_builder->CreateAlloca(type, nullptr, "array");
+    auto type = generate_type(node);
+    return_and_push_null_if_null(type);
 
-    auto length_index = build_gep_index({ 0, 0 });
-    auto elements_index = build_gep_index({ 0, 1 });
+    auto pointer_type = static_cast<typesystem::UnsafePointer *>(record->get_field_type("elements"));
+    auto element_type = generate_type(pointer_type->element_type());
+    return_and_push_null_if_null(element_type);
 
-    auto length = m_ir_builder->CreateInBoundsGEP(instance, length_index, "length");
-    m_ir_builder->CreateStore(llvm::ConstantInt::get(length_type, elements.size()), length);
+    // every evaluation gets storage of its own, as the array can outlive it; when it
+    // doesn't the heap to stack pass puts the storage back on the stack
+    auto allocate_type = llvm::FunctionType::get(
+        m_ir_builder->getInt8PtrTy(), { m_ir_builder->getInt64Ty() }, false
+    );
+    auto allocate = get_runtime_function("acorn_gc_allocate", allocate_type);
 
-    auto elements_value = m_ir_builder->CreateInBoundsGEP(instance, elements_index, "elements");
-    auto elements_instance = m_ir_builder->CreateAlloca(element_type, m_ir_builder->getInt32(elements.size()));
+    auto size = m_data_layout->getTypeAllocSize(element_type) * elements.size();
+    auto raw_storage = m_ir_builder->CreateCall(allocate, { m_ir_builder->getInt64(size) }, "storage");
+    auto storage = m_ir_builder->CreateBitCast(raw_storage, llvm::PointerType::getUnqual(element_type));
 
-    for (int i = 0; i < static_cast<int>(elements.size()); i++) {
-        auto index = build_gep_index({ i });
-        auto place = m_ir_builder->CreateInBoundsGEP(elements_instance, index);
+    for (size_t i = 0; i < elements.size(); i++) {
+        auto place = m_ir_builder->CreateInBoundsGEP(storage, m_ir_builder->getInt64(i));
         m_ir_builder->CreateStore(elements[i], place);
     }
 
-    m_ir_builder->CreateStore(elements_instance, elements_value);
+    auto instance = create_entry_block_alloca(type, "array");
+    m_ir_builder->CreateLifetimeStart(instance);
+
+    auto elements_index = static_cast<int>(record->get_field_index("elements"));
+    auto length_index = static_cast<int>(record->get_field_index("length"));
+    auto capacity_index = static_cast<int>(record->get_field_index("capacity"));
 
-    push_llvm_value(m_ir_builder->CreateLoad(instance));
+    auto count = m_ir_builder->getInt64(elements.size());
+    m_ir_builder->CreateStore(storage, create_inbounds_gep(instance, { 0, elements_index }));
+    m_ir_builder->CreateStore(count, create_inbounds_gep(instance, { 0, length_index }));
+    m_ir_builder->CreateStore(count, create_inbounds_gep(instance, { 0, capacity_index }));
+
+    auto array = m_ir_builder->CreateLoad(instance);
+    m_ir_builder->CreateLifetimeEnd(instance);
+
+    push_llvm_value(array);
 }
 
 void CodeGenerator::visit_tuple(ast::Tuple *node) {
     auto llvm_type = generate_type(node);
 
-    auto instance = m_ir_builder->CreateAlloca(llvm_type);
+    auto instance = create_entry_block_alloca(llvm_type, "tuple");
+    m_ir_builder->CreateLifetimeStart(instance);
 
     auto elements = node->elements();
     for (size_t i = 0; i < elements.size(); i++) {
@@ -640,43 +1192,130 @@ void CodeGenerator::visit_tuple(ast::Tuple *node) {
         m_ir_builder->CreateStore(value, ptr);
     }
 
-    push_llvm_value(m_ir_builder->CreateLoad(instance));
+    auto tuple = m_ir_builder->CreateLoad(instance);
+    m_ir_builder->CreateLifetimeEnd(instance);
+
+    push_llvm_value(tuple);
 }
 
 void CodeGenerator::visit_dictionary(ast::Dictionary *node) {
-    m_logger.warn("Visit ast::Dictionary not yet implemented.");
-    push_llvm_value(nullptr);
+    auto type = dynamic_cast<typesystem::Dictionary *>(node->type());
+    return_and_push_null_if_null(type);
+
+    auto key_type = generate_type(type->key_type());
+    return_and_push_null_if_null(key_type);
+
+    auto value_type = generate_type(type->value_type());
+    return_and_push_null_if_null(value_type);
+
+    auto count = static_cast<int>(node->keys().size());
+
+    // every entry is laid out up front so the runtime can size the table once and bulk insert
+    auto keys = create_entry_block_alloca(llvm::ArrayType::get(key_type, count), "keys");
+    auto values = create_entry_block_alloca(llvm::ArrayType::get(value_type, count), "values");
+    m_ir_builder->CreateLifetimeStart(keys);
+    m_ir_builder->CreateLifetimeStart(values);
+
+    for (int i = 0; i < count; i++) {
+        auto key = generate_llvm_value(node->keys()[i]);
+        return_and_push_null_if_null(key);
+
+        auto value = generate_llvm_value(node->values()[i]);
+        return_and_push_null_if_null(value);
+
+        m_ir_builder->CreateStore(key, create_inbounds_gep(keys, { 0, i }));
+        m_ir_builder->CreateStore(value, create_inbounds_gep(values, { 0, i }));
+    }
+
+    auto int8_pointer_type = m_ir_builder->getInt8PtrTy();
+    auto int64_type = m_ir_builder->getInt64Ty();
+
+    auto create_from_type = llvm::FunctionType::get(
+        int8_pointer_type,
+        { int64_type, int64_type, int64_type, int64_type, int8_pointer_type, int8_pointer_type },
+        false
+    );
+
+    std::vector<llvm::Value *> arguments = { m_ir_builder->getInt64(count) };
+    for (auto value : generate_dictionary_layout(node, type)) {
+        arguments.push_back(value);
+    }
+
+    arguments.push_back(m_ir_builder->CreateBitCast(keys, int8_pointer_type));
+    arguments.push_back(m_ir_builder->CreateBitCast(values, int8_pointer_type));
+
+    auto dictionary = m_ir_builder->CreateCall(
+        get_runtime_function("acorn_dictionary_create_from", create_from_type), arguments, "dictionary"
+    );
+
+    // the runtime has copied everything out by now
+    m_ir_builder->CreateLifetimeEnd(keys);
+    m_ir_builder->CreateLifetimeEnd(values);
+
+    push_llvm_value(dictionary);
 }
 
-void CodeGenerator::visit_call(ast::Call *node) {
+bool CodeGenerator::generate_call_function(ast::Call *node, llvm::Value *&function, ast::DefDecl *&builtin_definition) {
     auto operand = node->operand();
 
-    visit_node(operand);
-
     auto function_type = dynamic_cast<typesystem::Function *>(operand->type());
 
     auto method_index = node->get_method_index();
     auto method = function_type->get_method(method_index);
-    auto llvm_method_index = function_type->get_llvm_index(method);
-    auto llvm_specialisation_index = node->get_method_specialisation_index();
 
-    auto ir_function = llvm::dyn_cast<llvm::LoadInst>(pop_llvm_value())->getPointerOperand();
+    function = nullptr;
+    builtin_definition = nullptr;
 
-    auto ir_method = m_ir_builder->CreateLoad(
-        create_inbounds_gep(ir_function, { 0, llvm_method_index, llvm_specialisation_index })
-    );
+    // builtin operators are lowered to instructions at the call site
+    auto definition = m_reachability.definition_of(method);
+    if (definition != nullptr && definition->builtin()) {
+        builtin_definition = definition;
+        return true;
+    }
+
+    auto llvm_specialisation_index = get_concrete_specialisation_index(method, node->get_method_specialisation_index());
+    if (llvm_specialisation_index < 0) {
+        m_logger.critical("Could not find the type parameters of a call inside a generic method");
+        return false;
+    }
+
+    auto key = std::make_pair(method, llvm_specialisation_index);
+    if (definition != nullptr && !m_reachability.is_reachable(method, llvm_specialisation_index) &&
+            m_queued_specialisations.insert(key).second) {
+        m_pending_specialisations.push_back(key);
+    }
+
+    function = get_specialised_function(method, llvm_specialisation_index);
+
+    if (function == nullptr) {
+        // no definition to call directly, so go through the method table
+        visit_node(operand);
+
+        auto llvm_method_index = function_type->get_llvm_index(method);
+        auto ir_function = llvm::dyn_cast<llvm::LoadInst>(pop_llvm_value())->getPointerOperand();
+
+        function = m_ir_builder->CreateLoad(
+            create_inbounds_gep(ir_function, { 0, llvm_method_index, llvm_specialisation_index })
+        );
+    }
 
-    if (ir_method == nullptr) {
+    if (function == nullptr) {
         m_logger.critical("No LLVM function was available!");
-        push_llvm_value(nullptr);
-        return;
+        return false;
     }
 
-    std::vector<llvm::Value *> arguments;
+    return true;
+}
+
+bool CodeGenerator::generate_call_arguments(ast::Call *node, std::vector<llvm::Value *> &arguments) {
+    auto function_type = dynamic_cast<typesystem::Function *>(node->operand()->type());
+    auto method = function_type->get_method(node->get_method_index());
+
     int i = 0;
     bool valid;
     for (auto argument : method->ordered_arguments(node, &valid)) {
         auto value = generate_llvm_value(argument);
+        return_false_if_null(value);
 
         if (method->is_parameter_inout(method->parameter_types()[i])) {
             auto load = llvm::dyn_cast<llvm::LoadInst>(value);
@@ -691,12 +1330,54 @@ void CodeGenerator::visit_call(ast::Call *node) {
 
     if (!valid) {
         m_logger.critical("Could not order arguments!");
+        return false;
+    }
+
+    return true;
+}
+
+llvm::Value *CodeGenerator::generate_record_construction(ast::Call *node, std::vector<llvm::Value *> arguments) {
+    auto llvm_type = generate_type(node);
+    return_null_if_null(llvm_type);
+
+    llvm::Value *instance = llvm::UndefValue::get(llvm_type);
+    for (size_t i = 0; i < arguments.size(); i++) {
+        instance = m_ir_builder->CreateInsertValue(instance, arguments[i], static_cast<unsigned>(i));
+    }
+
+    return instance;
+}
+
+void CodeGenerator::visit_call(ast::Call *node) {
+    llvm::Value *function;
+    ast::DefDecl *builtin_definition;
+    std::vector<llvm::Value *> arguments;
+
+    // a generic record has no one constructor function, so its fields are filled in here
+    auto selector = llvm::dyn_cast<ast::Selector>(node->operand());
+    if (selector != nullptr && dynamic_cast<typesystem::RecordType *>(selector->operand()->type()) != nullptr) {
+        auto function_type = static_cast<typesystem::Function *>(node->operand()->type());
+        if (function_type->get_method(node->get_method_index())->is_abstract()) {
+            if (!generate_call_arguments(node, arguments)) {
+                push_llvm_value(nullptr);
+                return;
+            }
+
+            push_llvm_value(generate_record_construction(node, arguments));
+            return;
+        }
+    }
+
+    if (!generate_call_function(node, function, builtin_definition) || !generate_call_arguments(node, arguments)) {
         push_llvm_value(nullptr);
         return;
     }
 
-    auto call = m_ir_builder->CreateCall(ir_method, arguments);
-    push_llvm_value(call);
+    if (builtin_definition != nullptr) {
+        push_llvm_value(generate_builtin_method_call(builtin_definition, node, arguments, generate_type(node), node->type()));
+    } else {
+        push_llvm_value(m_ir_builder->CreateCall(function, arguments));
+    }
 }
 
 void CodeGenerator::visit_ccall(ast::CCall *node) {
@@ -739,14 +1420,30 @@ void CodeGenerator::visit_assignment(ast::Assignment *node) {
     llvm::Value *rhs_value = nullptr;
 
     if (node->builtin()) {
-        rhs_value = generate_builtin_variable(node->lhs());
+        rhs_value = generate_builtin_variable(node->declaration());
     } else {
         rhs_value = generate_llvm_value(node->rhs());
     }
 
     return_if_null(rhs_value);
 
-    auto lhs_pointer = generate_llvm_value(node->lhs());
+    llvm::Value *lhs_pointer = nullptr;
+
+    if (node->declaration()) {
+        lhs_pointer = generate_llvm_value(node->lhs());
+    } else {
+        // variables and fields are read with a load, and what it loads from is where to store
+        auto load = llvm::dyn_cast_or_null<llvm::LoadInst>(generate_llvm_value(node->lhs()));
+        if (load == nullptr) {
+            report(ConstantAssignmentError(node->lhs()));
+            push_llvm_value(nullptr);
+            return;
+        }
+
+        lhs_pointer = load->getPointerOperand();
+        load->eraseFromParent();
+    }
+
     return_if_null(lhs_pointer);
 
     m_ir_builder->CreateStore(rhs_value, lhs_pointer);
@@ -761,7 +1458,8 @@ void CodeGenerator::visit_selector(ast::Selector *node) {
     auto record_type = dynamic_cast<typesystem::Record *>(operand->type());
 
     if (module_type) {
-        auto module_name = static_cast<ast::Name *>(operand);
+        // names are read as parameterised names, even without any parameters
+        auto module_name = llvm::cast<ast::ParamName>(operand);
 
         auto symbol = scope()->lookup(this, module_name);
         return_and_push_null_if_null(symbol);
@@ -783,11 +1481,18 @@ void CodeGenerator::visit_selector(ast::Selector *node) {
         auto instance = generate_llvm_value(operand);
         return_if_null(instance);
 
-        auto actual_thing = llvm::cast<llvm::LoadInst>(instance)->getPointerOperand();
-
         auto record = dynamic_cast<typesystem::Record *>(operand->type());
 
         int index = record->get_field_index(node->field()->name()->value());
+
+        // a record that isn't in a variable, like one returned from a call, has no address
+        auto load = llvm::dyn_cast<llvm::LoadInst>(instance);
+        if (load == nullptr) {
+            push_llvm_value(m_ir_builder->CreateExtractValue(instance, static_cast<unsigned>(index)));
+            return;
+        }
+
+        auto actual_thing = load->getPointerOperand();
         auto value = m_ir_builder->CreateLoad(m_ir_builder->CreateInBoundsGEP(actual_thing, build_gep_index({ 0, index })));
         push_llvm_value(value);
     } else {
@@ -817,6 +1522,82 @@ void CodeGenerator::visit_while(ast::While *node) {
     m_ir_builder->SetInsertPoint(join_bb);
 }
 
+void CodeGenerator::visit_for(ast::For *node) {
+    auto iterable = generate_llvm_value(node->iterable());
+    return_and_push_null_if_null(iterable);
+
+    auto record = static_cast<typesystem::Record *>(node->iterable()->type());
+
+    llvm::Value *start = nullptr;
+    llvm::Value *stop = nullptr;
+    llvm::Value *elements = nullptr;
+
+    // loops over these count through an index rather than calling iterate and next, which
+    // leaves LLVM a plain induction variable it can vectorise
+    if (typesystem::is_range(record)) {
+        start = m_ir_builder->CreateExtractValue(iterable, record->get_field_index("start"), "start");
+        stop = m_ir_builder->CreateExtractValue(iterable, record->get_field_index("stop"), "stop");
+    } else {
+        if (typesystem::is_array_iterator(record)) {
+            start = m_ir_builder->CreateExtractValue(iterable, record->get_field_index("state"), "start");
+            iterable = m_ir_builder->CreateExtractValue(iterable, record->get_field_index("array"), "array");
+            record = static_cast<typesystem::Record *>(record->get_field_type("array"));
+        } else {
+            start = m_ir_builder->getInt64(0);
+        }
+
+        stop = m_ir_builder->CreateExtractValue(iterable, record->get_field_index("length"), "stop");
+        elements = m_ir_builder->CreateExtractValue(iterable, record->get_field_index("elements"), "elements");
+    }
+
+    auto loop_symbol = scope()->lookup_by_node(this, node);
+    return_and_push_null_if_null(loop_symbol);
+
+    push_scope(loop_symbol);
+
+    auto variable = generate_llvm_value(node->variable().get());
+    if (variable == nullptr) {
+        pop_scope();
+        push_llvm_value(nullptr);
+        return;
+    }
+
+    auto preheader_bb = m_ir_builder->GetInsertBlock();
+    auto header_bb = create_basic_block("for_header");
+    auto body_bb = create_basic_block("for_body");
+    auto join_bb = create_basic_block("for_join");
+
+    m_ir_builder->CreateBr(header_bb);
+
+    m_ir_builder->SetInsertPoint(header_bb);
+    auto index = m_ir_builder->CreatePHI(m_ir_builder->getInt64Ty(), 2, "index");
+    index->addIncoming(start, preheader_bb);
+
+    auto condition = m_ir_builder->CreateICmpSLT(index, stop, "for_cond");
+    m_ir_builder->CreateCondBr(condition, body_bb, join_bb);
+
+    m_ir_builder->SetInsertPoint(body_bb);
+
+    if (elements) {
+        auto element = m_ir_builder->CreateLoad(m_ir_builder->CreateInBoundsGEP(elements, index, "element"));
+        m_ir_builder->CreateStore(element, variable);
+    } else {
+        m_ir_builder->CreateStore(index, variable);
+    }
+
+    auto body_value = generate_llvm_value(node->body());
+    pop_scope();
+    return_and_push_null_if_null(body_value);
+
+    auto next_index = m_ir_builder->CreateNSWAdd(index, m_ir_builder->getInt64(1), "next_index");
+    index->addIncoming(next_index, m_ir_builder->GetInsertBlock());
+    m_ir_builder->CreateBr(header_bb);
+
+    m_ir_builder->SetInsertPoint(join_bb);
+
+    push_llvm_value(m_ir_builder->getInt1(false));
+}
+
 void CodeGenerator::visit_if(ast::If *node) {
     auto condition = generate_llvm_value(node->condition());
     return_and_push_null_if_null(condition);
@@ -834,6 +1615,11 @@ void CodeGenerator::visit_if(ast::If *node) {
     return_and_push_null_if_null(then_value);
     m_ir_builder->CreateBr(join_bb);
 
+    // without an else the if is Void, whatever its one case gives
+    if (!node->false_case()) {
+        then_value = m_ir_builder->getInt1(false);
+    }
+
     then_bb = m_ir_builder->GetInsertBlock();
 
     m_ir_builder->SetInsertPoint(else_bb);
@@ -868,111 +1654,232 @@ void CodeGenerator::visit_return(ast::Return *node) {
 }
 
 void CodeGenerator::visit_spawn(ast::Spawn *node) {
-    m_logger.warn("Visit ast::Spawn not yet implemented.");
-    push_llvm_value(nullptr);
-}
+    auto call = node->call().get();
 
-void CodeGenerator::visit_switch(ast::Switch *node) {
-    /*auto entry_block = create_basic_block("switch_entry");
-    m_ir_builder->CreateBr(entry_block);
+    llvm::Value *function;
+    ast::DefDecl *builtin_definition;
+    std::vector<llvm::Value *> arguments;
 
-    m_ir_builder->SetInsertPoint(entry_block);
-    expression->expression()->accept(this);
-    auto condition = pop_llvm_value();
+    if (!generate_call_function(call, function, builtin_definition) || !generate_call_arguments(call, arguments)) {
+        push_llvm_value(nullptr);
+        return;
+    }
+
+    auto result_type = generate_type(call);
+    return_and_push_null_if_null(result_type);
 
-    int case_no = 0;
-    for (auto case_ : expression->cases()) {
-        std::stringstream ss;
-        ss << "case_" << case_no;
+    // the frame holds the result first, so join can find it without knowing the rest of the
+    // layout, then whatever the thunk needs to make the call on a worker
+    std::vector<llvm::Type *> frame_fields = { result_type };
+    std::vector<llvm::Value *> frame_values;
 
-        auto code_block = create_basic_block(ss.str());
-        m_ir_builder->SetInsertPoint(code_block);
+    llvm::Function *thunk = nullptr;
 
-        case_no++;
+    if (builtin_definition != nullptr) {
+        // a builtin is a handful of instructions, not worth a trip through the scheduler
+        frame_values.push_back(generate_builtin_method_call(builtin_definition, call, arguments, result_type, call->type()));
+        return_and_push_null_if_null(frame_values[0]);
+    } else {
+        frame_fields.push_back(function->getType());
+        frame_values.push_back(nullptr);
+        frame_values.push_back(function);
+
+        for (auto argument : arguments) {
+            frame_fields.push_back(argument->getType());
+            frame_values.push_back(argument);
+        }
     }
 
-    auto exit_block = create_basic_block("switch_exit");
-    m_ir_builder->SetInsertPoint(entry_block);*/
+    auto frame_type = llvm::StructType::get(m_context, frame_fields);
 
-    m_logger.warn("Visit ast::Switch not yet implemented.");
-    push_llvm_value(nullptr);
-}
+    if (builtin_definition == nullptr) {
+        thunk = generate_spawn_thunk(frame_type);
+    }
 
-void CodeGenerator::visit_parameter(ast::Parameter *node) {
-    m_logger.warn("Visit ast::Parameter not yet implemented.");
-    push_llvm_value(nullptr);
+    auto allocate_type = llvm::FunctionType::get(
+        m_ir_builder->getInt8PtrTy(), { m_ir_builder->getInt64Ty() }, false
+    );
+    auto allocate = get_runtime_function("acorn_gc_allocate", allocate_type);
+
+    // the frame outlives this function, so it can't go on the stack
+    auto frame_size = m_data_layout->getTypeAllocSize(frame_type);
+    auto raw_frame = m_ir_builder->CreateCall(allocate, { m_ir_builder->getInt64(frame_size) }, "frame");
+    auto frame = m_ir_builder->CreateBitCast(raw_frame, llvm::PointerType::getUnqual(frame_type));
+
+    for (size_t i = 0; i < frame_values.size(); i++) {
+        if (frame_values[i] != nullptr) {
+            m_ir_builder->CreateStore(frame_values[i], create_inbounds_gep(frame, { 0, static_cast<int>(i) }));
+        }
+    }
+
+    auto thunk_pointer_type = llvm::PointerType::getUnqual(
+        llvm::FunctionType::get(m_ir_builder->getVoidTy(), { m_ir_builder->getInt8PtrTy() }, false)
+    );
+
+    auto spawn_type = llvm::FunctionType::get(
+        m_ir_builder->getInt8PtrTy(), { thunk_pointer_type, m_ir_builder->getInt8PtrTy() }, false
+    );
+    auto spawn = get_runtime_function("acorn_task_spawn", spawn_type);
+
+    llvm::Value *llvm_thunk = thunk;
+    if (thunk == nullptr) {
+        // a null function tells the scheduler the task is already complete
+        llvm_thunk = llvm::ConstantPointerNull::get(thunk_pointer_type);
+    }
+
+    push_llvm_value(m_ir_builder->CreateCall(spawn, { llvm_thunk, raw_frame }, "task"));
 }
 
-void CodeGenerator::visit_def_decl(ast::DefDecl *node) {
-    auto function_symbol = scope()->lookup(this, node->name());
-    auto function_type = static_cast<typesystem::Function *>(function_symbol->type());
+llvm::Function *CodeGenerator::generate_spawn_thunk(llvm::StructType *frame_type) {
+    auto thunk_type = llvm::FunctionType::get(
+        m_ir_builder->getVoidTy(), { m_ir_builder->getInt8PtrTy() }, false
+    );
+    auto thunk = llvm::Function::Create(
+        thunk_type, llvm::Function::InternalLinkage, "spawn_thunk", module()
+    );
 
-    if (!function_symbol->has_llvm_value()) {
-        auto llvm_function_type = generate_type(function_type);
-        auto llvm_initialiser = take_initialiser();
+    push_insert_point();
+    create_entry_basic_block(thunk, true);
 
-        function_symbol->set_llvm_value(
-            create_global_variable(
-                llvm_function_type, llvm_initialiser,
-                node->name()->name()->value()
-            )
-        );
+    auto frame = m_ir_builder->CreateBitCast(&*thunk->arg_begin(), llvm::PointerType::getUnqual(frame_type));
+
+    auto function = m_ir_builder->CreateLoad(create_inbounds_gep(frame, { 0, 1 }));
+
+    std::vector<llvm::Value *> arguments;
+    for (unsigned int i = 2; i < frame_type->getNumElements(); i++) {
+        arguments.push_back(m_ir_builder->CreateLoad(create_inbounds_gep(frame, { 0, static_cast<int>(i) })));
     }
 
-    auto method = static_cast<typesystem::Method *>(node->type());
+    auto result = m_ir_builder->CreateCall(function, arguments);
+    m_ir_builder->CreateStore(result, create_inbounds_gep(frame, { 0, 0 }));
+    m_ir_builder->CreateRetVoid();
 
-    auto symbol = function_symbol->scope()->lookup_by_node(this, node);
+    pop_insert_point();
+
+    return thunk;
+}
 
-    auto llvm_function_name = codegen::mangle_method(function_symbol->name(), method);
+void CodeGenerator::visit_switch(ast::Switch *node) {
+    auto expression = generate_llvm_value(node->expression());
+    return_and_push_null_if_null(expression);
 
-    auto llvm_method_type = llvm::cast<llvm::StructType>(generate_type(node));
+    auto type = generate_type(node);
+    return_and_push_null_if_null(type);
 
-    int specialisation_index = 0;
-    for (auto specialisation : method->generic_specialisations()) {
-        push_replacement_generic_specialisation(specialisation);
+    auto &cases = node->cases();
 
-        push_scope(symbol);
-        push_insert_point();
+    std::vector<llvm::BasicBlock *> case_bbs;
+    for (size_t i = 0; i < cases.size(); i++) {
+        case_bbs.push_back(create_basic_block("switch_case"));
+    }
+
+    auto default_bb = create_basic_block("switch_default");
+    auto join_bb = create_basic_block("switch_join");
 
-        auto llvm_specialised_method_type = llvm::cast<llvm::PointerType>(llvm_method_type->getElementType(specialisation_index))->getElementType();
+    bool all_literals = expression->getType()->isIntegerTy();
+    for (auto &case_ : cases) {
+        all_literals = all_literals && llvm::isa<ast::Int>(case_->condition().get());
+    }
 
-        auto function = create_function(llvm_specialised_method_type, llvm_function_name);
-        return_and_push_null_if_null(function);
+    if (all_literals) {
+        // one instruction for the whole dispatch, which LLVM can turn into a jump table,
+        // a lookup table or a balanced tree of comparisons
+        auto switch_instruction = m_ir_builder->CreateSwitch(expression, default_bb, cases.size());
 
-        create_entry_basic_block(function, true);
-        prepare_method_parameters(node, function);
+        for (size_t i = 0; i < cases.size(); i++) {
+            auto value = llvm::dyn_cast_or_null<llvm::ConstantInt>(generate_llvm_value(cases[i]->condition()));
+            return_and_push_null_if_null(value);
 
-        if (node->builtin()) {
-            generate_builtin_method_body(node, function);
-        } else {
-            visit_node(node->body().get());
+            // an earlier case with the same value always wins
+            if (switch_instruction->findCaseValue(value) == switch_instruction->case_default()) {
+                switch_instruction->addCase(value, case_bbs[i]);
+            }
+        }
+    } else {
+        // anything else is compared case by case, in order
+        bool is_float = expression->getType()->isFloatingPointTy();
+
+        for (size_t i = 0; i < cases.size(); i++) {
+            auto condition = generate_llvm_value(cases[i]->condition());
+            return_and_push_null_if_null(condition);
+
+            llvm::Value *matches = nullptr;
+            if (is_float) {
+                matches = m_ir_builder->CreateFCmpOEQ(expression, condition, "case_matches");
+            } else {
+                matches = m_ir_builder->CreateICmpEQ(expression, condition, "case_matches");
+            }
+
+            auto next_bb = i + 1 < cases.size() ? create_basic_block("switch_next") : default_bb;
+            m_ir_builder->CreateCondBr(matches, case_bbs[i], next_bb);
+            m_ir_builder->SetInsertPoint(next_bb);
         }
 
-        auto value = pop_llvm_value();
-        return_and_push_null_if_null(value);
-        m_ir_builder->CreateRet(value);
+        if (cases.empty()) {
+            m_ir_builder->CreateBr(default_bb);
+        }
+    }
 
-        pop_insert_point();
-        pop_scope();
+    std::vector<std::pair<llvm::Value *, llvm::BasicBlock *>> incoming;
 
-        if (!verify_function(node, function)) {
-            push_llvm_value(nullptr);
-            return;
+    for (size_t i = 0; i < cases.size(); i++) {
+        m_ir_builder->SetInsertPoint(case_bbs[i]);
+
+        if (cases[i]->assignment()) {
+            auto assignment = generate_llvm_value(cases[i]->assignment());
+            return_and_push_null_if_null(assignment);
         }
 
-        // FIXME return something better, like a load to the GEP pointer
-        symbol->set_llvm_value(function);
+        auto value = generate_llvm_value(cases[i]->body());
+        return_and_push_null_if_null(value);
 
-        int llvm_method_index = function_type->get_llvm_index(method);
-        create_store_method_to_function(
-            function, function_symbol->llvm_value(), llvm_method_index, specialisation_index
-        );
+        incoming.push_back({ value, m_ir_builder->GetInsertBlock() });
+        m_ir_builder->CreateBr(join_bb);
+    }
 
-        pop_replacement_generic_specialisation(specialisation);
-        specialisation_index += 1;
+    m_ir_builder->SetInsertPoint(default_bb);
+
+    llvm::Value *default_value = nullptr;
+    if (node->default_case()) {
+        default_value = generate_llvm_value(node->default_case());
+    } else {
+        default_value = llvm::Constant::getNullValue(type);
     }
+    return_and_push_null_if_null(default_value);
 
-    push_llvm_value(symbol->llvm_value());
+    incoming.push_back({ default_value, m_ir_builder->GetInsertBlock() });
+    m_ir_builder->CreateBr(join_bb);
+
+    m_ir_builder->SetInsertPoint(join_bb);
+
+    auto phi = m_ir_builder->CreatePHI(type, incoming.size(), "switch_value");
+    for (auto &entry : incoming) {
+        phi->addIncoming(entry.first, entry.second);
+    }
+
+    push_llvm_value(phi);
+}
+
+void CodeGenerator::visit_parameter(ast::Parameter *node) {
+    m_logger.warn("Visit ast::Parameter not yet implemented.");
+    push_llvm_value(nullptr);
+}
+
+void CodeGenerator::visit_def_decl(ast::DefDecl *node) {
+    if (!generate_definition(node)) {
+        push_llvm_value(nullptr);
+        return;
+    }
+
+    // a function only has a value when reachability saw it used as one, so its method table was made
+    auto function_symbol = scope()->lookup(this, node->name());
+    if (!function_symbol->has_llvm_value()) {
+        report(InternalError(node, "no value was generated for this definition"));
+        push_llvm_value(nullptr);
+        return;
+    }
+
+    push_llvm_value(function_symbol->llvm_value());
 }
 
 void CodeGenerator::visit_type_decl(ast::TypeDecl *node) {
@@ -980,9 +1887,12 @@ void CodeGenerator::visit_type_decl(ast::TypeDecl *node) {
         auto symbol = scope()->lookup(this, node->name());
         return_and_push_null_if_null(symbol);
 
-        // FIXME create a proper type
-        symbol->set_llvm_value(m_ir_builder->getInt1(0));
-        push_llvm_value(symbol->llvm_value());
+        // FIXME create a proper type, for now it's a placeholder that can be passed as a Type{T}
+        auto variable = create_global_variable(m_ir_builder->getInt1Ty(), m_ir_builder->getInt1(0), node->name()->name()->value());
+        return_and_push_null_if_null(variable);
+
+        symbol->set_llvm_value(variable);
+        push_llvm_value(variable);
         return;
     }
 
@@ -1010,6 +1920,12 @@ void CodeGenerator::visit_type_decl(ast::TypeDecl *node) {
         auto function_type = node_type->constructor();
         auto method_type = function_type->get_method(0);
 
+        // generic records are built where they're constructed instead
+        if (method_type->is_abstract()) {
+            push_llvm_value(variable);
+            return;
+        }
+
         std::string mangled_name = codegen::mangle_method(node->name()->name()->value(), method_type);
 
         auto llvm_method_type = llvm::cast<llvm::StructType>(generate_type(method_type));
@@ -1020,6 +1936,8 @@ void CodeGenerator::visit_type_decl(ast::TypeDecl *node) {
 
         method->addFnAttr(llvm::Attribute::AlwaysInline);
 
+        m_specialised_functions[std::make_pair(method_type, 0)] = method;
+
         auto function = variable;
         create_store_method_to_function(method, function, 0, 0);
 
@@ -1048,8 +1966,9 @@ void CodeGenerator::visit_module_decl(ast::ModuleDecl *node) {
     auto symbol = scope()->lookup(this, node->name());
     return_and_push_null_if_null(symbol);
 
+    // the name has no value of its own, only the module's contents do
     push_scope(symbol);
-    ast::Visitor::visit_module_decl(node);
+    visit_node(node->body().get());
     pop_scope();
 }
 
@@ -1074,13 +1993,18 @@ void CodeGenerator::visit_source_file(ast::SourceFile *node) {
         auto main_function = create_function(int32_function_type, "main");
         auto main_bb = create_entry_basic_block(main_function);
 
+        m_reachability.visit_source_file(node);
+
         m_ir_builder->SetInsertPoint(user_code_bb);
 
         ast::Visitor::visit_source_file(node);
 
+        generate_pending_specialised_functions();
+
         m_ir_builder->CreateRetVoid();
 
         m_ir_builder->SetInsertPoint(main_bb);
+        generate_runtime_initialisation();
         m_ir_builder->CreateCall(m_init_variables_function);
         m_ir_builder->CreateCall(user_code_function);
         m_ir_builder->CreateRet(m_ir_builder->getInt32(0));
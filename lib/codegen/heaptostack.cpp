@@ -0,0 +1,138 @@
+#include <set>
+#include <vector>
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+
+#include "acorn/statistics.h"
+
+#include "acorn/codegen/heaptostack.h"
+
+using namespace acorn;
+using namespace acorn::codegen;
+
+static statistics::Counter stack_allocation_count("stack_allocations", "GC allocations moved to the stack");
+
+// anything bigger stays on the heap, a recursive method could otherwise blow the stack
+static const uint64_t max_stack_allocation_size = 1024;
+
+char HeapToStack::ID = 0;
+
+HeapToStack::HeapToStack() : llvm::FunctionPass(ID) {
+
+}
+
+bool HeapToStack::runOnFunction(llvm::Function &function) {
+    std::vector<llvm::CallInst *> candidates;
+
+    for (auto &basic_block : function) {
+        for (auto &instruction : basic_block) {
+            auto call = llvm::dyn_cast<llvm::CallInst>(&instruction);
+            if (call && is_candidate(call)) {
+                candidates.push_back(call);
+            }
+        }
+    }
+
+    for (auto call : candidates) {
+        move_to_stack(call);
+    }
+
+    return !candidates.empty();
+}
+
+void HeapToStack::getAnalysisUsage(llvm::AnalysisUsage &usage) const {
+    usage.setPreservesCFG();
+}
+
+bool HeapToStack::is_candidate(llvm::CallInst *call) const {
+    auto callee = call->getCalledFunction();
+    if (callee == nullptr || callee->getName() != "acorn_gc_allocate") {
+        return false;
+    }
+
+    // by the time this runs GC.allocate has been inlined, so the size is only constant if the amount was
+    auto size = llvm::dyn_cast<llvm::ConstantInt>(call->getArgOperand(0));
+    if (size == nullptr || size->getZExtValue() > max_stack_allocation_size) {
+        return false;
+    }
+
+    return !is_escaping(call);
+}
+
+bool HeapToStack::is_escaping(llvm::Value *pointer) const {
+    std::vector<llvm::Value *> pending = { pointer };
+    std::set<llvm::Value *> visited = { pointer };
+
+    while (!pending.empty()) {
+        auto value = pending.back();
+        pending.pop_back();
+
+        for (auto user : value->users()) {
+            if (llvm::isa<llvm::LoadInst>(user) || llvm::isa<llvm::ICmpInst>(user)) {
+                continue;
+            }
+
+            // storing into the allocation is fine, storing the allocation somewhere is not
+            if (auto store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+                if (store->getValueOperand() == value) {
+                    return true;
+                }
+                continue;
+            }
+
+            if (llvm::isa<llvm::MemIntrinsic>(user)) {
+                continue;
+            }
+
+            if (auto intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(user)) {
+                auto id = intrinsic->getIntrinsicID();
+                if (id == llvm::Intrinsic::lifetime_start || id == llvm::Intrinsic::lifetime_end) {
+                    continue;
+                }
+                return true;
+            }
+
+            // derived pointers are followed, but a phi or select would let one iteration's
+            // allocation outlive the next, which a single stack slot can't represent
+            if (llvm::isa<llvm::GetElementPtrInst>(user) || llvm::isa<llvm::BitCastInst>(user)) {
+                if (visited.insert(user).second) {
+                    pending.push_back(user);
+                }
+                continue;
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void HeapToStack::move_to_stack(llvm::CallInst *call) {
+    auto function = call->getFunction();
+    auto size = llvm::cast<llvm::ConstantInt>(call->getArgOperand(0))->getZExtValue();
+
+    llvm::IRBuilder<> entry_builder(&function->getEntryBlock(), function->getEntryBlock().begin());
+    auto alloca = entry_builder.CreateAlloca(
+        llvm::ArrayType::get(entry_builder.getInt8Ty(), size), nullptr, "stack_allocation"
+    );
+    alloca->setAlignment(8);
+
+    // the heap hands out zeroed memory, and a loop needs it zeroed again on every iteration
+    llvm::IRBuilder<> builder(call);
+    auto pointer = builder.CreateBitCast(alloca, call->getType());
+    builder.CreateMemSet(pointer, builder.getInt8(0), size, 8);
+
+    call->replaceAllUsesWith(pointer);
+    call->eraseFromParent();
+
+    ++stack_allocation_count;
+}
+
+llvm::FunctionPass *codegen::create_heap_to_stack_pass() {
+    return new HeapToStack();
+}
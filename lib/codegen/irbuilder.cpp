@@ -44,6 +44,14 @@ llvm::BasicBlock *IrBuilder::create_entry_basic_block(llvm::Function *function,
     return create_basic_block("entry", function, set_insert_point);
 }
 
+llvm::AllocaInst *IrBuilder::create_entry_block_alloca(llvm::Type *type, std::string name) {
+    // an alloca anywhere else grows the stack every time it runs, and isn't promoted to a register
+    auto &entry = m_ir_builder->GetInsertBlock()->getParent()->getEntryBlock();
+
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+    return entry_builder.CreateAlloca(type, nullptr, name);
+}
+
 std::vector<llvm::Value *> IrBuilder::build_gep_index(std::initializer_list<int> indexes) {
     std::vector<llvm::Value *> values;
     for (int index : indexes) {
@@ -0,0 +1,135 @@
+#include "acorn/ast/nodes.h"
+#include "acorn/typesystem/types.h"
+
+#include "acorn/codegen/reachability.h"
+
+using namespace acorn;
+using namespace acorn::codegen;
+
+Reachability::Reachability() : ast::Visitor("acorn.reachability"), m_source_file_depth(0) { }
+
+bool Reachability::is_reachable(typesystem::Method *method, int specialisation_index) const {
+    return m_reachable.find(std::make_pair(method, specialisation_index)) != m_reachable.end();
+}
+
+bool Reachability::is_escaping(typesystem::Function *function) const {
+    return m_escaping.find(function) != m_escaping.end();
+}
+
+ast::DefDecl *Reachability::definition_of(typesystem::Method *method) const {
+    auto it = m_definitions.find(method);
+    if (it == m_definitions.end()) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+void Reachability::mark_reachable(typesystem::Method *method, int specialisation_index) {
+    if (m_reachable.insert(std::make_pair(method, specialisation_index)).second) {
+        m_pending_methods.push_back(method);
+    }
+}
+
+void Reachability::mark_escaping(typesystem::Function *function) {
+    m_escaping.insert(function);
+
+    for (auto method : function->methods()) {
+        m_escaping_methods.insert(method);
+
+        for (size_t i = 0; i < method->no_generic_specialisation(); i++) {
+            mark_reachable(method, static_cast<int>(i));
+        }
+    }
+}
+
+void Reachability::visit_pending_methods() {
+    while (!m_pending_methods.empty()) {
+        auto method = m_pending_methods.back();
+        m_pending_methods.pop_back();
+
+        // constructors and builtins have no body to follow
+        auto it = m_definitions.find(method);
+        if (it == m_definitions.end() || it->second->builtin()) {
+            continue;
+        }
+
+        if (m_visited_definitions.insert(it->second).second) {
+            visit_node(it->second->body());
+        }
+    }
+}
+
+void Reachability::remove_inlined_builtins() {
+    // builtins are lowered inline at each call, so they only need a body when used as a value
+    for (auto it = m_reachable.begin(); it != m_reachable.end();) {
+        auto definition = definition_of(it->first);
+
+        if (definition != nullptr && definition->builtin() && m_escaping_methods.find(it->first) == m_escaping_methods.end()) {
+            it = m_reachable.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Reachability::visit_name(ast::Name *node) {
+    // a function used as a value could be called with any of its methods
+    auto function = dynamic_cast<typesystem::Function *>(node->type());
+    if (function != nullptr) {
+        mark_escaping(function);
+    }
+}
+
+void Reachability::visit_call(ast::Call *node) {
+    auto operand = node->operand();
+
+    auto function = dynamic_cast<typesystem::Function *>(operand->type());
+    if (function != nullptr) {
+        auto method = function->get_method(node->get_method_index());
+        mark_reachable(method, node->get_method_specialisation_index());
+    }
+
+    // the callee itself has been resolved statically, so only follow other operands
+    if (!llvm::isa<ast::ParamName>(operand) && !llvm::isa<ast::Name>(operand) && !llvm::isa<ast::Selector>(operand)) {
+        visit_node(operand);
+    }
+
+    for (auto &positional_argument : node->positional_arguments()) {
+        visit_node(positional_argument);
+    }
+
+    for (auto &keyword_argument : node->keyword_arguments()) {
+        visit_node(keyword_argument.second);
+    }
+}
+
+void Reachability::visit_selector(ast::Selector *node) {
+    auto function = dynamic_cast<typesystem::Function *>(node->type());
+    if (function != nullptr) {
+        mark_escaping(function);
+    }
+
+    if (node->operand()) {
+        visit_node(node->operand());
+    }
+}
+
+void Reachability::visit_def_decl(ast::DefDecl *node) {
+    // bodies are only followed once something calls them
+    auto method = dynamic_cast<typesystem::Method *>(node->type());
+    if (method != nullptr) {
+        m_definitions[method] = node;
+    }
+}
+
+void Reachability::visit_source_file(ast::SourceFile *node) {
+    m_source_file_depth++;
+    ast::Visitor::visit_source_file(node);
+    m_source_file_depth--;
+
+    if (m_source_file_depth == 0) {
+        visit_pending_methods();
+        remove_inlined_builtins();
+    }
+}
@@ -1,18 +1,47 @@
+#include <algorithm>
 #include <iostream>
+#include <set>
 
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/CodeGen/ParallelCG.h>
+#include <llvm/Config/llvm-config.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/RTDyldMemoryManager.h>
 #include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
 #include <llvm/ExecutionEngine/Orc/LambdaResolver.h>
 #include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
-#include <llvm/Support/DynamicLibrary.h>
-#include <llvm/Support/TargetSelect.h>
-#include <llvm/Support/TargetRegistry.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Pass.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/StringSaver.h>
 #include <llvm/Support/ToolOutputFile.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/AlwaysInliner.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+
+#ifdef ACORN_HAVE_LLD
+#include <lld/Common/Driver.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "acorn/ast/nodes.h"
+#include "acorn/cache.h"
 #include "acorn/codegen/generator.h"
+#include "acorn/codegen/heaptostack.h"
+#include "acorn/jit.h"
 #include "acorn/parser/scanner.h"
 #include "acorn/parser/parser.h"
 #include "acorn/prettyprinter.h"
@@ -28,108 +57,528 @@ using namespace acorn::compiler;
 using namespace acorn::diagnostics;
 using namespace acorn::parser;
 
-Compiler::Compiler() : m_logger("acorn.compiler") {
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmPrinters();
-    llvm::InitializeAllAsmParsers();
+static statistics::Counter instruction_count("instructions", "LLVM instructions emitted after optimisation");
+
+// a hash of this compiler and the runtime it links in, so rebuilding either one misses the
+// cache even when the version hasn't changed, or empty if either can't be read
+static std::string get_build_identity() {
+    static const auto identity = []() -> std::string {
+        auto executable = llvm::sys::fs::getMainExecutable(nullptr, reinterpret_cast<void *>(&get_build_identity));
+
+        cache::KeyBuilder key_builder;
+        if (executable.empty() || !key_builder.add_file(executable) || !key_builder.add_file(ACORN_RUNTIME_LIBRARY)) {
+            return "";
+        }
+
+        return key_builder.key();
+    }();
 
-    auto registry = llvm::PassRegistry::getPassRegistry();
-    llvm::initializeCore(*registry);
-    llvm::initializeCodeGen(*registry);
-    llvm::initializeLoopStrengthReducePass(*registry);
-    llvm::initializeLowerIntrinsicsPass(*registry);
+    return identity;
+}
 
-    llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+Compiler::Compiler(session::Session *session) :
+    m_logger("acorn.compiler"),
+    m_session(session),
+    m_optimisation_level(0),
+    m_size_level(0),
+    m_jobs(1),
+    m_time_phases(false),
+    m_emit_kind(EmitKind::Executable) {
+    if (m_session == nullptr) {
+        m_own_session = std::make_unique<session::Session>();
+        m_session = m_own_session.get();
+    }
 }
 
 Compiler::~Compiler() { }
 
 ast::SourceFile *Compiler::parse(const std::string filename, symboltable::Namespace *root_namespace) {
+    statistics::ScopedPhase phase(m_statistics, "parse");
+
     m_logger.info("initialising scanner and parser");
 
-    Scanner scanner(filename);
-    Parser parser(scanner);
+    auto path = resolve_path(filename);
+
+    Scanner scanner(path);
+    Parser parser(scanner, resolve_path("stdlib"), &m_session->import_cache());
 
     m_logger.info("scanning and parsing file");
 
-    auto source_file = parser.parse(filename);
+    auto source_file = parser.parse(path);
 
     if (scanner.has_errors() || parser.has_errors() || !source_file) {
         return nullptr;
     }
 
-    m_logger.info("building symbol table");
+    return source_file.release();
+}
+
+bool Compiler::check(ast::SourceFile *module, symboltable::Namespace *root_namespace) {
+    {
+        statistics::ScopedPhase phase(m_statistics, "symbol table");
+
+        m_logger.info("building symbol table");
 
-    symboltable::Builder symbol_table_builder(root_namespace);
-    symbol_table_builder.visit_source_file(source_file.get());
-    assert(symbol_table_builder.is_at_root());
+        symboltable::Builder symbol_table_builder(root_namespace);
+        symbol_table_builder.visit_source_file(module);
+        assert(symbol_table_builder.is_at_root());
+
+        if (symbol_table_builder.has_errors()) {
+            return false;
+        }
+    }
 
-    return_null_if_has_errors(symbol_table_builder);
+    {
+        statistics::ScopedPhase phase(m_statistics, "type check");
 
-    m_logger.info("running type checker");
+        m_logger.info("running type checker");
 
-    typesystem::TypeChecker type_checker(root_namespace);
-    type_checker.visit_source_file(source_file.get());
+        typesystem::TypeChecker type_checker(root_namespace);
+        type_checker.visit_source_file(module);
 
-    return_null_if_has_errors(type_checker);
+        if (type_checker.has_errors()) {
+            return false;
+        }
+    }
 
     m_logger.debug(root_namespace->to_string());
 
-    return source_file.release();
+    return true;
 }
 
 bool Compiler::compile(ast::SourceFile *module, symboltable::Namespace *root_namespace, std::string filename) {
-    auto output_name = filename + ".o";
-    auto module_name = filename.substr(0, filename.find_last_of("."));
+    auto module_name = get_output_name(filename);
 
-    m_logger.info("{} -> {}", filename, output_name);
+    m_logger.info("{} -> {}", filename, module_name);
 
     auto triple = get_triple();
-    auto target_machine = get_target_machine(triple);
+    auto target = get_target(triple);
+    if (target == nullptr) {
+        return false;
+    }
 
-    auto data_layout = target_machine->createDataLayout();
+    auto target_machine = target->machine.get();
 
-    codegen::CodeGenerator generator(root_namespace, &data_layout);
-    generator.visit_source_file(module);
+    session::ContextLease context_lease(m_session);
 
-    if (generator.has_errors()) {
-        return false;
-    }
+    std::unique_ptr<llvm::Module> llvm_module;
 
-    auto llvm_module = generator.module();
+    {
+        statistics::ScopedPhase phase(m_statistics, "codegen");
 
-    delete module;
+        codegen::CodeGenerator generator(context_lease.context(), root_namespace, &target->data_layout);
+        generator.visit_source_file(module);
+
+        if (generator.has_errors()) {
+            return false;
+        }
+
+        llvm_module = generator.take_module();
+    }
 
-    m_logger.debug("generating object file");
+    delete module;
 
     llvm_module->setTargetTriple(triple.str());
 
-    llvm_module->print(llvm::errs(), nullptr);
+    m_logger.debug("optimising module at -O{}", m_optimisation_level);
 
-    llvm::legacy::PassManager pass_manager;
+    {
+        statistics::ScopedPhase phase(m_statistics, "optimise");
+
+        // inlining and the other interprocedural passes need to see the whole module, so only
+        // the backend runs per partition
+        optimise(llvm_module.get(), target_machine);
+        count_instructions(llvm_module.get());
+    }
+
+    std::vector<llvm::SmallVector<char, 0>> object_buffers;
+
+    {
+        statistics::ScopedPhase phase(m_statistics, "emit");
+
+        if (m_emit_kind != EmitKind::Executable) {
+            return emit_file(llvm_module.get(), target_machine, module_name);
+        }
+
+        if (m_cache_directory.empty()) {
+            emit_partitioned_objects(std::move(llvm_module), triple, object_buffers);
+        } else if (!emit_incremental_objects(std::move(llvm_module), target_machine, object_buffers)) {
+            return false;
+        }
+    }
+
+    m_logger.debug("linking {}", module_name);
+
+    statistics::ScopedPhase phase(m_statistics, "link");
+
+    return link(object_buffers, module_name);
+}
+
+void Compiler::emit_partitioned_objects(std::unique_ptr<llvm::Module> module, llvm::Triple triple,
+                                        std::vector<llvm::SmallVector<char, 0>> &objects) {
+    m_logger.debug("generating object files with {} jobs", m_jobs);
+
+    objects.resize(m_jobs);
+
+    std::vector<std::unique_ptr<llvm::raw_svector_ostream>> object_streams;
+    std::vector<llvm::raw_pwrite_stream *> object_stream_pointers;
+    for (auto &buffer : objects) {
+        object_streams.push_back(std::make_unique<llvm::raw_svector_ostream>(buffer));
+        object_stream_pointers.push_back(object_streams.back().get());
+    }
+
+    // each partition is code generated on its own thread in its own LLVMContext
+    llvm::splitCodeGen(
+        std::move(module), object_stream_pointers, {},
+        [&]() {
+            return m_session->create_target_machine(
+                triple.str(), get_target_cpu(), get_target_features(), get_codegen_optimisation_level()
+            );
+        },
+        llvm::TargetMachine::CGFT_ObjectFile
+    );
+}
+
+// a module with copies of just these definitions and declarations of whatever they refer
+// to, so making one costs the size of the definitions rather than of the whole module
+static std::unique_ptr<llvm::Module> extract_fragment(llvm::Module *module,
+                                                      const std::vector<llvm::GlobalValue *> &definitions) {
+    auto fragment = std::make_unique<llvm::Module>(module->getModuleIdentifier(), module->getContext());
+    fragment->setDataLayout(module->getDataLayout());
+    fragment->setTargetTriple(module->getTargetTriple());
+
+    llvm::ValueToValueMapTy value_map;
+
+    for (auto definition : definitions) {
+        if (auto function = llvm::dyn_cast<llvm::Function>(definition)) {
+            auto copy = llvm::Function::Create(
+                function->getFunctionType(), function->getLinkage(), function->getName(), fragment.get()
+            );
+            copy->copyAttributesFrom(function);
+
+            auto copy_argument = copy->arg_begin();
+            for (auto &argument : function->args()) {
+                copy_argument->setName(argument.getName());
+                value_map[&argument] = &*copy_argument++;
+            }
+
+            value_map[function] = copy;
+        } else if (auto variable = llvm::dyn_cast<llvm::GlobalVariable>(definition)) {
+            auto copy = new llvm::GlobalVariable(
+                *fragment, variable->getValueType(), variable->isConstant(), variable->getLinkage(),
+                nullptr, variable->getName()
+            );
+            copy->copyAttributesFrom(variable);
+
+            value_map[variable] = copy;
+        }
+    }
+
+    // find the other globals the definitions use, including through constant expressions
+    std::vector<const llvm::Value *> pending;
+    std::set<const llvm::Value *> seen;
+    auto add_operands = [&pending](const llvm::User *user) {
+        for (auto &operand : user->operands()) {
+            pending.push_back(operand.get());
+        }
+    };
+
+    for (auto definition : definitions) {
+        if (auto function = llvm::dyn_cast<llvm::Function>(definition)) {
+            for (auto &basic_block : *function) {
+                for (auto &instruction : basic_block) {
+                    add_operands(&instruction);
+                }
+            }
+        } else if (auto variable = llvm::dyn_cast<llvm::GlobalVariable>(definition)) {
+            if (variable->hasInitializer()) {
+                pending.push_back(variable->getInitializer());
+            }
+        }
+    }
+
+    while (!pending.empty()) {
+        auto value = pending.back();
+        pending.pop_back();
+
+        if (!seen.insert(value).second || value_map.count(value) > 0) {
+            continue;
+        }
+
+        if (auto function = llvm::dyn_cast<llvm::Function>(value)) {
+            auto declaration = llvm::Function::Create(
+                function->getFunctionType(), llvm::GlobalValue::ExternalLinkage, function->getName(), fragment.get()
+            );
+            declaration->copyAttributesFrom(function);
+            value_map[function] = declaration;
+        } else if (auto variable = llvm::dyn_cast<llvm::GlobalVariable>(value)) {
+            auto declaration = new llvm::GlobalVariable(
+                *fragment, variable->getValueType(), variable->isConstant(), llvm::GlobalValue::ExternalLinkage,
+                nullptr, variable->getName()
+            );
+            declaration->copyAttributesFrom(variable);
+            value_map[variable] = declaration;
+        } else if (auto constant = llvm::dyn_cast<llvm::Constant>(value)) {
+            add_operands(constant);
+        }
+    }
+
+    for (auto definition : definitions) {
+        if (auto function = llvm::dyn_cast<llvm::Function>(definition)) {
+            auto copy = llvm::cast<llvm::Function>(value_map[function]);
+
+            llvm::SmallVector<llvm::ReturnInst *, 8> returns;
+            llvm::CloneFunctionInto(copy, function, value_map, true, returns);
+        } else if (auto variable = llvm::dyn_cast<llvm::GlobalVariable>(definition)) {
+            if (variable->hasInitializer()) {
+                auto copy = llvm::cast<llvm::GlobalVariable>(value_map[variable]);
+                copy->setInitializer(llvm::MapValue(variable->getInitializer(), value_map));
+            }
+        }
+    }
+
+    return fragment;
+}
+
+// a numbered name would change whenever something before it did, and with it every fragment key that mentions it
+static std::string get_content_name(llvm::GlobalValue &global) {
+    std::string contents;
+    llvm::raw_string_ostream contents_stream(contents);
+
+    global.getValueType()->print(contents_stream);
+    if (auto variable = llvm::dyn_cast<llvm::GlobalVariable>(&global)) {
+        contents_stream << (variable->isConstant() ? " constant " : " global ");
+        variable->getInitializer()->print(contents_stream);
+    } else if (auto function = llvm::dyn_cast<llvm::Function>(&global)) {
+        for (auto &basic_block : *function) {
+            basic_block.print(contents_stream);
+        }
+    }
+
+    cache::KeyBuilder key_builder;
+    key_builder.add(contents_stream.str());
+    return key_builder.key().substr(0, 16);
+}
+
+bool Compiler::emit_incremental_objects(std::unique_ptr<llvm::Module> module, llvm::TargetMachine *target_machine,
+                                        std::vector<llvm::SmallVector<char, 0>> &objects) {
+    cache::Cache cache(resolve_path(m_cache_directory));
+
+    cache::KeyBuilder target_key_builder;
+    if (!add_target_to_key(target_key_builder)) {
+        m_logger.warn("unable to read the compiler or runtime to identify this build, not caching");
+        emit_partitioned_objects(std::move(module), get_triple(), objects);
+        return true;
+    }
+
+    if (m_jobs > 1) {
+        m_logger.warn("-j is ignored with --cache-dir, object fragments are generated on one thread");
+    }
+
+    auto target_key = target_key_builder.key();
+
+    // every definition gets its own object, so anything local has to become visible to the
+    // other objects, and anything unnamed needs a name to be referred to by
+    for (auto &global : module->global_values()) {
+        if (global.isDeclaration()) {
+            continue;
+        }
+
+        if (!global.hasName()) {
+            global.setName("acorn.anonymous." + get_content_name(global));
+        }
+
+        if (global.hasLocalLinkage()) {
+            global.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            global.setVisibility(llvm::GlobalValue::HiddenVisibility);
+        }
+    }
+
+    // a function's printed IR covers its body and the signature of everything it references
+    auto get_fragment_key = [&target_key](llvm::function_ref<void(llvm::raw_ostream &)> print) {
+        std::string ir;
+        llvm::raw_string_ostream ir_stream(ir);
+        print(ir_stream);
+
+        cache::KeyBuilder key_builder;
+        key_builder.add(target_key);
+        key_builder.add(ir_stream.str());
+        return key_builder.key();
+    };
+
+    // global variables are small, so they're kept together in one fragment
+    auto globals_key = get_fragment_key([&module](llvm::raw_ostream &os) {
+        for (auto &global : module->globals()) {
+            global.print(os);
+            os << "\n";
+        }
+    });
+
+    std::vector<llvm::GlobalValue *> globals;
+    for (auto &global : module->globals()) {
+        if (!global.isDeclaration()) {
+            globals.push_back(&global);
+        }
+    }
+
+    std::vector<std::pair<std::vector<llvm::GlobalValue *>, std::string>> fragments = { { globals, globals_key } };
+    for (auto &function : module->functions()) {
+        if (!function.isDeclaration()) {
+            fragments.emplace_back(
+                std::vector<llvm::GlobalValue *> { &function },
+                get_fragment_key([&function](llvm::raw_ostream &os) { function.print(os); })
+            );
+        }
+    }
+
+    int regenerated = 0;
+
+    for (auto &fragment : fragments) {
+        auto &key = fragment.second;
+
+        objects.emplace_back();
+        if (cache.load_object(key, objects.back())) {
+            continue;
+        }
+
+        // a missing fragment would only show up as undefined symbols when linking
+        auto fragment_module = extract_fragment(module.get(), fragment.first);
+        if (!emit_object(fragment_module.get(), target_machine, objects.back())) {
+            return false;
+        }
+
+        cache.store_object(key, objects.back());
+        regenerated++;
+    }
+
+    m_logger.debug("regenerated {} of {} object fragments", regenerated, fragments.size());
+
+    return true;
+}
+
+void Compiler::count_instructions(llvm::Module *module) {
+    uint64_t count = 0;
+    for (auto &function : *module) {
+        for (auto &basic_block : function) {
+            count += basic_block.size();
+        }
+    }
+
+    instruction_count += count;
+}
+
+bool Compiler::emit_file(llvm::Module *module, llvm::TargetMachine *target_machine, const std::string &output_name) {
+    bool binary = m_emit_kind == EmitKind::Bitcode || m_emit_kind == EmitKind::Object;
 
     std::error_code error_code;
-    llvm::ToolOutputFile output_file(output_name, error_code, llvm::sys::fs::F_None);
+    llvm::ToolOutputFile output_file(output_name, error_code, binary ? llvm::sys::fs::F_None : llvm::sys::fs::F_Text);
+    if (error_code) {
+        m_logger.error("unable to open {}: {}", output_name, error_code.message());
+        return false;
+    }
 
-    target_machine->addPassesToEmitFile(pass_manager, output_file.os(), llvm::TargetMachine::CGFT_ObjectFile);
+    switch (m_emit_kind) {
+        case EmitKind::LLVMIR:
+            module->print(output_file.os(), nullptr);
+            break;
+        case EmitKind::Bitcode:
+            llvm::WriteBitcodeToFile(module, output_file.os());
+            break;
+        case EmitKind::Assembly:
+        case EmitKind::Object: {
+            llvm::SmallVector<char, 0> buffer;
+            auto file_type = m_emit_kind == EmitKind::Assembly ? llvm::TargetMachine::CGFT_AssemblyFile : llvm::TargetMachine::CGFT_ObjectFile;
+            if (!emit_object(module, target_machine, buffer, file_type)) {
+                return false;
+            }
 
-    pass_manager.run(*llvm_module);
+            output_file.os().write(buffer.data(), buffer.size());
+            break;
+        }
+        default:
+            assert(false && "ast and executables aren't emitted from a module");
+            return false;
+    }
 
     output_file.keep();
-    output_file.os().close();
 
-    m_logger.debug("Compiling object file...");
+    return true;
+}
 
-    std::string cmd = "clang " + output_name + " -o " + module_name;
-    system(cmd.c_str());
+bool Compiler::emit_object(llvm::Module *module, llvm::TargetMachine *target_machine, llvm::SmallVectorImpl<char> &object,
+                           llvm::TargetMachine::CodeGenFileType file_type) {
+    llvm::raw_svector_ostream object_stream(object);
 
-    remove(output_name.c_str());
+    llvm::legacy::PassManager pass_manager;
+    if (target_machine->addPassesToEmitFile(pass_manager, object_stream, file_type)) {
+        m_logger.error("the target machine can't emit an object file");
+        return false;
+    }
+
+    pass_manager.run(*module);
 
     return true;
 }
 
+int Compiler::run(ast::SourceFile *module, symboltable::Namespace *root_namespace) {
+    // the JIT owns the module until it's destroyed, so the context has to outlive it
+    session::ContextLease context_lease(m_session);
+
+    jit::Jit jit(get_codegen_optimisation_level());
+
+    auto data_layout = jit.data_layout();
+
+    std::unique_ptr<llvm::Module> llvm_module;
+
+    {
+        statistics::ScopedPhase phase(m_statistics, "codegen");
+
+        codegen::CodeGenerator generator(context_lease.context(), root_namespace, &data_layout);
+        generator.visit_source_file(module);
+
+        if (generator.has_errors()) {
+            return 1;
+        }
+
+        llvm_module = generator.take_module();
+    }
+
+    delete module;
+
+    llvm_module->setTargetTriple(jit.target_machine().getTargetTriple().str());
+
+    {
+        statistics::ScopedPhase phase(m_statistics, "optimise");
+
+        optimise(llvm_module.get(), &jit.target_machine());
+        count_instructions(llvm_module.get());
+    }
+
+    m_logger.debug("running module in the JIT");
+
+    llvm::JITTargetAddress main_address;
+
+    {
+        statistics::ScopedPhase phase(m_statistics, "jit");
+
+        jit.add_module(std::move(llvm_module));
+
+        main_address = jit.find_symbol_address("main");
+        if (main_address == 0) {
+            return 1;
+        }
+    }
+
+    // the program may never return control to us, so report before handing it over
+    report_statistics();
+
+    auto main_function = reinterpret_cast<int (*)()>(static_cast<intptr_t>(main_address));
+    return main_function();
+}
+
 int Compiler::parse_and_compile(const std::string filename) {
+    m_statistics.reset();
+
     auto root_namespace = std::make_unique<symboltable::Namespace>(nullptr);
 
     auto source_file = parse(filename, root_namespace.get());
@@ -137,18 +586,449 @@ int Compiler::parse_and_compile(const std::string filename) {
         return 2;
     }
 
-    PrettyPrinter pp;
-    pp.visit_source_file(source_file);
-    m_logger.debug(pp.str());
+    // the key only needs the parsed imports, so a hit skips checking and code generation
+    std::unique_ptr<cache::Cache> cache;
+    std::string cache_key;
+    if (!m_cache_directory.empty() && m_emit_kind == EmitKind::Executable) {
+        cache = std::make_unique<cache::Cache>(resolve_path(m_cache_directory));
+        cache_key = get_cache_key(source_file);
+
+        if (!cache_key.empty() && cache->restore(cache_key, get_output_name(filename))) {
+            delete source_file;
+            return 0;
+        }
+    }
+
+    if (!check(source_file, root_namespace.get())) {
+        delete source_file;
+        return 2;
+    }
+
+    if (m_emit_kind == EmitKind::AST) {
+        auto emitted = emit_ast(source_file, get_output_name(filename));
+        delete source_file;
+        return emitted ? 0 : 1;
+    }
 
     if (!compile(source_file, root_namespace.get(), filename)) {
         return 1;
     }
 
+    if (cache && !cache_key.empty()) {
+        cache->store(cache_key, get_output_name(filename));
+    }
+
     return 0;
 }
 
+void Compiler::set_optimisation_level(unsigned int level, unsigned int size_level) {
+    m_optimisation_level = level;
+    m_size_level = size_level;
+}
+
+void Compiler::set_cache_directory(const std::string directory) {
+    m_cache_directory = directory;
+}
+
+void Compiler::set_time_phases(bool time_phases) {
+    m_time_phases = time_phases;
+
+    // forward to LLVM's own -time-passes, which reports when LLVM shuts down
+    llvm::TimePassesIsEnabled = time_phases;
+}
+
+void Compiler::set_statistics_filename(const std::string filename) {
+    m_statistics_filename = filename;
+}
+
+void Compiler::report_statistics() {
+    m_statistics.end_phase();
+
+    if (m_statistics.empty()) {
+        return;
+    }
+
+    if (m_time_phases) {
+        m_statistics.print_table(llvm::errs());
+    }
+
+    if (!m_statistics_filename.empty()) {
+        std::error_code error_code;
+        llvm::raw_fd_ostream os(m_statistics_filename, error_code, llvm::sys::fs::F_Text);
+        if (error_code) {
+            m_logger.error("unable to write statistics to {}: {}", m_statistics_filename, error_code.message());
+        } else {
+            m_statistics.print_json(os);
+        }
+    }
+
+    m_statistics.reset();
+}
+
+void Compiler::set_jobs(unsigned int jobs) {
+    m_jobs = std::max(jobs, 1u);
+}
+
+bool Compiler::emit_ast(ast::SourceFile *module, const std::string &output_name) {
+    std::error_code error_code;
+    llvm::ToolOutputFile output_file(output_name, error_code, llvm::sys::fs::F_Text);
+    if (error_code) {
+        m_logger.error("unable to open {}: {}", output_name, error_code.message());
+        return false;
+    }
+
+    PrettyPrinter pp;
+    pp.visit_source_file(module);
+    output_file.os() << pp.str();
+
+    output_file.keep();
+
+    return true;
+}
+
+void Compiler::set_emit_kind(EmitKind emit_kind) {
+    m_emit_kind = emit_kind;
+}
+
+void Compiler::set_output_filename(const std::string filename) {
+    m_output_filename = filename;
+}
+
+void Compiler::set_working_directory(const std::string directory) {
+    m_working_directory = directory;
+}
+
+int Compiler::parse_and_run(const std::string filename) {
+    m_statistics.reset();
+
+    auto root_namespace = std::make_unique<symboltable::Namespace>(nullptr);
+
+    auto source_file = parse(filename, root_namespace.get());
+    if (source_file == nullptr) {
+        return 2;
+    }
+
+    if (!check(source_file, root_namespace.get())) {
+        delete source_file;
+        return 2;
+    }
+
+    return run(source_file, root_namespace.get());
+}
+
+// the system compiler driver, found once, it knows where the C runtime and libc live
+static const std::string &get_linker_driver() {
+    static const auto driver = []() -> std::string {
+        for (auto name : { "cc", "clang", "gcc" }) {
+            if (auto path = llvm::sys::findProgramByName(name)) {
+                return *path;
+            }
+        }
+
+        return "";
+    }();
+
+    return driver;
+}
+
+#ifdef ACORN_HAVE_LLD
+static const char *object_placeholder = "acorn-objects.o";
+static const char *output_placeholder = "acorn-output";
+
+// the arguments the driver would run its linker with, with placeholders for the objects and output, so LLD
+// gets the same C runtime objects, library paths and dynamic linker; empty if the driver won't say
+static std::vector<std::string> get_driver_link_arguments(const std::string &driver) {
+    llvm::SmallString<128> output_name;
+    if (llvm::sys::fs::createTemporaryFile("acorn", "txt", output_name)) {
+        return {};
+    }
+
+    // -### prints the commands the driver would run without running them
+    const char *args[] = {
+        driver.c_str(), "-###", object_placeholder, ACORN_RUNTIME_LIBRARY, "-lpthread", "-o", output_placeholder, nullptr
+    };
+    llvm::Optional<llvm::StringRef> redirects[] = { llvm::None, llvm::None, llvm::StringRef(output_name) };
+    int exit_code = llvm::sys::ExecuteAndWait(driver, args, nullptr, redirects);
+
+    auto output = llvm::MemoryBuffer::getFile(output_name);
+    llvm::sys::fs::remove(output_name);
+
+    if (exit_code != 0 || !output) {
+        return {};
+    }
+
+    // the link is the last command, the one given the objects
+    llvm::SmallVector<llvm::StringRef, 8> lines;
+    (*output)->getBuffer().split(lines, '\n', -1, false);
+
+    auto link_line = std::find_if(lines.rbegin(), lines.rend(), [](llvm::StringRef line) {
+        return line.contains(object_placeholder) && !line.startswith("COLLECT_GCC_OPTIONS");
+    });
+    if (link_line == lines.rend()) {
+        return {};
+    }
+
+    llvm::BumpPtrAllocator allocator;
+    llvm::StringSaver saver(allocator);
+    llvm::SmallVector<const char *, 64> tokens;
+    llvm::cl::TokenizeGNUCommandLine(*link_line, saver, tokens);
+
+    // the first token is the driver's own linker, and GCC's LTO plugin is only for its own linker
+    std::vector<std::string> arguments;
+    for (size_t i = 1; i < tokens.size(); i++) {
+        llvm::StringRef token(tokens[i]);
+        if (token == "-plugin") {
+            i++;
+        } else if (!token.startswith("-plugin-opt")) {
+            arguments.push_back(token.str());
+        }
+    }
+
+    return arguments;
+}
+
+// links without writing the objects to disk or starting another program, each object is handed to LLD as an
+// anonymous in memory file; false if it couldn't link, so the driver can be tried instead
+static bool link_in_process(const std::vector<llvm::SmallVector<char, 0>> &objects, const std::string &output_name,
+                            diagnostics::Logger &logger) {
+    static const auto arguments = get_driver_link_arguments(get_linker_driver());
+    if (arguments.empty()) {
+        return false;
+    }
+
+    std::vector<int> object_fds;
+    std::vector<std::string> object_names;
+    auto close_objects = [&object_fds]() {
+        for (auto object_fd : object_fds) {
+            close(object_fd);
+        }
+    };
+
+    for (auto &object : objects) {
+        // a partition can come out empty when there are fewer functions than jobs
+        if (object.empty()) {
+            continue;
+        }
+
+        int object_fd = memfd_create("acorn.o", MFD_CLOEXEC);
+        if (object_fd < 0) {
+            close_objects();
+            return false;
+        }
+
+        object_fds.push_back(object_fd);
+        object_names.push_back("/proc/self/fd/" + std::to_string(object_fd));
+
+        llvm::raw_fd_ostream object_file(object_fd, false);
+        object_file.write(object.data(), object.size());
+        object_file.flush();
+
+        if (object_file.has_error()) {
+            object_file.clear_error();
+            close_objects();
+            return false;
+        }
+    }
+
+    std::vector<const char *> args = { "ld.lld" };
+    for (auto &argument : arguments) {
+        if (argument == object_placeholder) {
+            for (auto &object_name : object_names) {
+                args.push_back(object_name.c_str());
+            }
+        } else if (argument == output_placeholder) {
+            args.push_back(output_name.c_str());
+        } else {
+            args.push_back(argument.c_str());
+        }
+    }
+
+    std::string messages;
+    llvm::raw_string_ostream messages_stream(messages);
+    bool linked = lld::elf::link(args, false, messages_stream);
+
+    close_objects();
+
+    if (!linked) {
+        logger.debug("LLD was unable to link {}, trying {}: {}", output_name, get_linker_driver(), messages_stream.str());
+    }
+
+    return linked;
+}
+#endif
+
+bool Compiler::link(const std::vector<llvm::SmallVector<char, 0>> &objects, const std::string &output_name) {
+#ifdef ACORN_HAVE_LLD
+    if (link_in_process(objects, output_name, m_logger)) {
+        return true;
+    }
+#endif
+
+    // the objects only touch the disk for the driver's sake, as a single write each to a temporary file
+    std::vector<llvm::SmallString<128>> object_names;
+    auto remove_objects = [&object_names]() {
+        for (auto &object_name : object_names) {
+            llvm::sys::fs::remove(object_name);
+        }
+    };
+
+    for (auto &object : objects) {
+        // a partition can come out empty when there are fewer functions than jobs
+        if (object.empty()) {
+            continue;
+        }
+
+        int object_fd;
+        llvm::SmallString<128> object_name;
+        if (auto error_code = llvm::sys::fs::createTemporaryFile("acorn", "o", object_fd, object_name)) {
+            m_logger.error("unable to create a temporary object file: {}", error_code.message());
+            remove_objects();
+            return false;
+        }
+
+        object_names.push_back(object_name);
+
+        llvm::raw_fd_ostream object_file(object_fd, true);
+        object_file.write(object.data(), object.size());
+        object_file.close();
+
+        if (object_file.has_error()) {
+            m_logger.error("unable to write {}: {}", object_name.c_str(), object_file.error().message());
+            object_file.clear_error();
+            remove_objects();
+            return false;
+        }
+    }
+
+    auto &linker = get_linker_driver();
+    if (linker.empty()) {
+        m_logger.error("unable to find a linker driver (cc, clang or gcc) on PATH");
+        remove_objects();
+        return false;
+    }
+
+    std::vector<const char *> args = { linker.c_str() };
+    for (auto &object_name : object_names) {
+        args.push_back(object_name.c_str());
+    }
+    args.push_back(ACORN_RUNTIME_LIBRARY);
+    args.push_back("-lpthread");
+    args.push_back("-o");
+    args.push_back(output_name.c_str());
+    args.push_back(nullptr);
+
+    // run the driver directly rather than through a shell
+    std::string error_message;
+    int exit_code = llvm::sys::ExecuteAndWait(linker, args.data(), nullptr, {}, 0, 0, &error_message);
+
+    remove_objects();
+
+    if (exit_code != 0) {
+        m_logger.error("{} exited with {} {}", linker, exit_code, error_message);
+        return false;
+    }
+
+    return true;
+}
+
+// relative to the directory the compile was asked for in, which for a server isn't its own
+std::string Compiler::resolve_path(const std::string path) const {
+    if (m_working_directory.empty() || path.empty() || path == "-" || llvm::sys::path::is_absolute(path)) {
+        return path;
+    }
+
+    llvm::SmallString<128> resolved(m_working_directory);
+    llvm::sys::path::append(resolved, path);
+    return resolved.str();
+}
+
+std::string Compiler::get_output_name(const std::string filename) const {
+    if (!m_output_filename.empty()) {
+        return resolve_path(m_output_filename);
+    }
+
+    auto path = resolve_path(filename);
+    auto module_name = path.substr(0, path.find_last_of("."));
+
+    switch (m_emit_kind) {
+        case EmitKind::AST:
+            return module_name + ".ast";
+        case EmitKind::LLVMIR:
+            return module_name + ".ll";
+        case EmitKind::Bitcode:
+            return module_name + ".bc";
+        case EmitKind::Assembly:
+            return module_name + ".s";
+        case EmitKind::Object:
+            return module_name + ".o";
+        default:
+            return module_name;
+    }
+}
+
+bool Compiler::add_target_to_key(cache::KeyBuilder &key_builder) const {
+    auto build_identity = get_build_identity();
+    if (build_identity.empty()) {
+        return false;
+    }
+
+    key_builder.add(ACORN_VERSION);
+    key_builder.add(LLVM_VERSION_STRING);
+    key_builder.add(build_identity);
+
+    auto triple = get_triple();
+    key_builder.add(triple.str());
+    key_builder.add(get_target_cpu());
+    key_builder.add(get_target_features());
+
+    key_builder.add(std::to_string(m_optimisation_level));
+    key_builder.add(std::to_string(m_size_level));
+
+    return true;
+}
+
+std::string Compiler::get_cache_key(ast::SourceFile *module) const {
+    cache::KeyBuilder key_builder;
+    if (!add_target_to_key(key_builder)) {
+        return "";
+    }
+
+    // the entry file and everything it transitively imports, in a stable order
+    std::set<std::string> filenames;
+    std::vector<ast::SourceFile *> pending = { module };
+    while (!pending.empty()) {
+        auto source_file = pending.back();
+        pending.pop_back();
+
+        filenames.insert(source_file->name());
+
+        for (auto &import : source_file->imports()) {
+            pending.push_back(import.get());
+        }
+    }
+
+    for (auto &filename : filenames) {
+        if (!key_builder.add_file(filename)) {
+            return "";
+        }
+    }
+
+    return key_builder.key();
+}
+
+void Compiler::set_target(const std::string triple) {
+    m_target = triple;
+}
+
+bool Compiler::is_cross_compiling() const {
+    return !m_target.empty();
+}
+
 llvm::Triple Compiler::get_triple() const {
+    if (is_cross_compiling()) {
+        return llvm::Triple(llvm::Triple::normalize(m_target));
+    }
+
     llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
 
     if (triple.getOS() == llvm::Triple::Darwin &&
@@ -171,25 +1051,94 @@ llvm::Triple Compiler::get_triple() const {
     return triple;
 }
 
-llvm::TargetMachine *Compiler::get_target_machine(llvm::Triple triple) const {
-    std::string error;
-    const auto target = llvm::TargetRegistry::lookupTarget(triple.str(), error);
+llvm::CodeGenOpt::Level Compiler::get_codegen_optimisation_level() const {
+    switch (m_optimisation_level) {
+        case 0:
+            return llvm::CodeGenOpt::None;
+        case 1:
+            return llvm::CodeGenOpt::Less;
+        case 2:
+            return llvm::CodeGenOpt::Default;
+        default:
+            return llvm::CodeGenOpt::Aggressive;
+    }
+}
 
-    auto cpu = llvm::sys::getHostCPUName();
-    auto opt_level = llvm::CodeGenOpt::None;
-    llvm::TargetOptions target_options;
+std::string Compiler::get_target_cpu() const {
+    if (is_cross_compiling()) {
+        return "generic";
+    }
 
-    llvm::SubtargetFeatures features;
+    return m_session->host_cpu_name();
+}
+
+std::string Compiler::get_target_features() const {
+    if (is_cross_compiling()) {
+        return "";
+    }
+
+    return m_session->host_cpu_features();
+}
+
+session::Target *Compiler::get_target(llvm::Triple triple) {
+    if (is_cross_compiling()) {
+        m_session->initialise_all_targets();
+    }
+
+    return m_session->get_target(triple.str(), get_target_cpu(), get_target_features(), get_codegen_optimisation_level());
+}
+
+void Compiler::optimise(llvm::Module *module, llvm::TargetMachine *target_machine) const {
+    llvm::PassManagerBuilder builder;
+    builder.OptLevel = m_optimisation_level;
+    builder.SizeLevel = m_size_level;
 
-    llvm::StringMap<bool> host_features;
-    llvm::sys::getHostCPUFeatures(host_features);
-    for (auto &it : host_features) {
-        features.AddFeature(it.first(), it.second);
+    // record constructors are marked always inline, so they're inlined even at -O0
+    if (m_optimisation_level > 1) {
+        builder.Inliner = llvm::createFunctionInliningPass(m_optimisation_level, m_size_level, false);
+    } else {
+        builder.Inliner = llvm::createAlwaysInlinerLegacyPass();
     }
-    auto target_features = features.getString();
 
-    return target->createTargetMachine(
-        triple.str(), cpu, target_features, target_options,
-        llvm::Reloc::DynamicNoPIC, llvm::CodeModel::Small, opt_level
+    builder.LoopVectorize = m_optimisation_level > 1 && m_size_level < 2;
+    builder.SLPVectorize = m_optimisation_level > 1 && m_size_level < 2;
+    builder.LibraryInfo = new llvm::TargetLibraryInfoImpl(llvm::Triple(module->getTargetTriple()));
+
+    // after inlining, so allocations made by a callee can be seen not to escape the caller,
+    // then SROA so the stack copies that are only ever used field by field end up in registers
+    builder.addExtension(
+        llvm::PassManagerBuilder::EP_ScalarOptimizerLate,
+        [](const llvm::PassManagerBuilder &, llvm::legacy::PassManagerBase &pass_manager) {
+            pass_manager.add(codegen::create_heap_to_stack_pass());
+            pass_manager.add(llvm::createSROAPass());
+        }
+    );
+
+    // splits off the iterations where a bounds check could fail, so the main loop runs without any
+    builder.addExtension(
+        llvm::PassManagerBuilder::EP_LoopOptimizerEnd,
+        [](const llvm::PassManagerBuilder &builder, llvm::legacy::PassManagerBase &pass_manager) {
+            if (builder.OptLevel > 1) {
+                pass_manager.add(llvm::createInductiveRangeCheckEliminationPass());
+            }
+        }
     );
+
+    target_machine->adjustPassManager(builder);
+
+    llvm::legacy::FunctionPassManager function_pass_manager(module);
+    function_pass_manager.add(llvm::createTargetTransformInfoWrapperPass(target_machine->getTargetIRAnalysis()));
+    builder.populateFunctionPassManager(function_pass_manager);
+
+    llvm::legacy::PassManager module_pass_manager;
+    module_pass_manager.add(llvm::createTargetTransformInfoWrapperPass(target_machine->getTargetIRAnalysis()));
+    builder.populateModulePassManager(module_pass_manager);
+
+    function_pass_manager.doInitialization();
+    for (auto &function : *module) {
+        function_pass_manager.run(function);
+    }
+    function_pass_manager.doFinalization();
+
+    module_pass_manager.run(*module);
 }
@@ -124,6 +124,12 @@ ConstantAssignmentError::ConstantAssignmentError(ast::Node *node)
     m_message = "Variable is not mutable.";
 }
 
+InternalError::InternalError(ast::Node *node, std::string message)
+    : CompilerError(node) {
+    m_prefix = "Internal error";
+    m_message = message;
+}
+
 Logger::Logger(const char *name) {
     if (name == nullptr) {
         name = "acorn";
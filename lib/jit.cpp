@@ -0,0 +1,87 @@
+#include <set>
+
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/RTDyldMemoryManager.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/Orc/LambdaResolver.h>
+#include <llvm/IR/Mangler.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "acornrt.h"
+
+#include "acorn/jit.h"
+
+using namespace acorn;
+using namespace acorn::jit;
+
+static void add_runtime_symbols() {
+    // programs call into libc and the rest of this process through the resolver's fallback
+    llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+
+    // the runtime is linked statically into acorn, so its symbols aren't in the dynamic symbol table
+#define ACORN_RUNTIME_FUNCTION(return_type, name, parameters, attributes) \
+    llvm::sys::DynamicLibrary::AddSymbol(#name, reinterpret_cast<void *>(&name));
+#include "acornrt.def"
+}
+
+Jit::Jit(llvm::CodeGenOpt::Level optimisation_level) :
+    m_logger("acorn.jit"),
+    m_target_machine(llvm::EngineBuilder().setOptLevel(optimisation_level).selectTarget()),
+    m_data_layout(m_target_machine->createDataLayout()),
+    m_object_layer([]() { return std::make_shared<llvm::SectionMemoryManager>(); }),
+    m_compile_layer(m_object_layer, llvm::orc::SimpleCompiler(*m_target_machine)),
+    m_compile_callback_manager(llvm::orc::createLocalCompileCallbackManager(m_target_machine->getTargetTriple(), 0)),
+    m_compile_on_demand_layer(
+        m_compile_layer,
+        [](llvm::Function &function) { return std::set<llvm::Function *>({ &function }); },
+        *m_compile_callback_manager,
+        llvm::orc::createLocalIndirectStubsManagerBuilder(m_target_machine->getTargetTriple())
+    ) {
+    add_runtime_symbols();
+}
+
+llvm::TargetMachine &Jit::target_machine() {
+    return *m_target_machine;
+}
+
+const llvm::DataLayout &Jit::data_layout() const {
+    return m_data_layout;
+}
+
+void Jit::add_module(std::unique_ptr<llvm::Module> module) {
+    // look inside the JIT first, then fall back to the symbols of this process
+    auto resolver = llvm::orc::createLambdaResolver(
+        [this](const std::string &name) {
+            if (auto symbol = m_compile_on_demand_layer.findSymbol(name, false)) {
+                return symbol;
+            }
+
+            return llvm::JITSymbol(nullptr);
+        },
+        [](const std::string &name) {
+            if (auto address = llvm::RTDyldMemoryManager::getSymbolAddressInProcess(name)) {
+                return llvm::JITSymbol(address, llvm::JITSymbolFlags::Exported);
+            }
+
+            return llvm::JITSymbol(nullptr);
+        }
+    );
+
+    llvm::cantFail(m_compile_on_demand_layer.addModule(std::move(module), std::move(resolver)));
+}
+
+llvm::JITTargetAddress Jit::find_symbol_address(const std::string name) {
+    std::string mangled_name;
+    llvm::raw_string_ostream mangled_name_stream(mangled_name);
+    llvm::Mangler::getNameWithPrefix(mangled_name_stream, name, m_data_layout);
+
+    auto symbol = m_compile_on_demand_layer.findSymbol(mangled_name_stream.str(), true);
+    if (!symbol) {
+        m_logger.error("symbol not found: {}", name);
+        return 0;
+    }
+
+    return llvm::cantFail(symbol.getAddress());
+}
@@ -2,6 +2,9 @@
 #include <memory>
 #include <sstream>
 
+#include <llvm/Support/FileSystem.h>
+
+#include "acorn/ast/cloner.h"
 #include "acorn/ast/nodes.h"
 #include "acorn/diagnostics.h"
 #include "acorn/parser/scanner.h"
@@ -17,9 +20,60 @@ using namespace acorn::parser;
 // useful variable for storing the current token
 static Token token;
 
-Parser::Parser(Scanner &scanner) :
+static bool get_modification_time(const std::string &filename, llvm::sys::TimePoint<> &time) {
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(filename, status)) {
+        return false;
+    }
+
+    time = status.getLastModificationTime();
+    return true;
+}
+
+std::unique_ptr<SourceFile> ImportCache::find(const std::string &filename) {
+    auto it = m_entries.find(filename);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+
+    // an edit to the file or anything it imports means parsing it again
+    for (auto &entry : it->second.modification_times) {
+        llvm::sys::TimePoint<> time;
+        if (!get_modification_time(entry.first, time) || time != entry.second) {
+            m_entries.erase(it);
+            return nullptr;
+        }
+    }
+
+    return clone(it->second.source_file.get());
+}
+
+void ImportCache::insert(SourceFile *source_file) {
+    Entry entry;
+
+    std::vector<SourceFile *> pending = { source_file };
+    while (!pending.empty()) {
+        auto file = pending.back();
+        pending.pop_back();
+
+        if (!get_modification_time(file->name(), entry.modification_times[file->name()])) {
+            return;
+        }
+
+        for (auto &import : file->imports()) {
+            pending.push_back(import.get());
+        }
+    }
+
+    entry.source_file = clone(source_file);
+    m_entries[source_file->name()] = std::move(entry);
+}
+
+Parser::Parser(Scanner &scanner, std::string import_directory, ImportCache *import_cache) :
     m_logger("acorn.parser"),
-    m_scanner(scanner) {
+    m_scanner(scanner),
+    m_import_directory(import_directory),
+    m_import_cache(import_cache) {
     m_logger.info("initialising");
 
     m_operator_precendence["+"] = 1;
@@ -38,10 +92,17 @@ std::unique_ptr<SourceFile> Parser::parse(std::string name) {
         auto import = read_import_expression();
         return_null_if_null(import);
 
-        std::string filename = "stdlib/" + import->path()->value() + ".acorn";
+        std::string filename = m_import_directory + "/" + import->path()->value() + ".acorn";
+
+        if (m_import_cache != nullptr) {
+            if (auto cached_module = m_import_cache->find(filename)) {
+                imports.push_back(std::move(cached_module));
+                continue;
+            }
+        }
 
         Scanner scanner(filename);
-        Parser parser(scanner);
+        Parser parser(scanner, m_import_directory, m_import_cache);
 
         auto imported_module = parser.parse(filename);
 
@@ -49,6 +110,10 @@ std::unique_ptr<SourceFile> Parser::parse(std::string name) {
             return nullptr;
         }
 
+        if (m_import_cache != nullptr) {
+            m_import_cache->insert(imported_module.get());
+        }
+
         imports.push_back(std::move(imported_module));
     }
 
@@ -63,9 +128,28 @@ std::unique_ptr<SourceFile> Parser::parse(std::string name) {
 
     auto code = std::make_unique<Block>(block_token, std::move(expressions));
 
-    return std::make_unique<SourceFile>(
+    auto source_file = std::make_unique<SourceFile>(
         source_token, name, std::move(imports), std::move(code)
     );
+
+    std::set<std::string> seen = { name };
+    remove_repeated_imports(source_file.get(), seen);
+
+    return source_file;
+}
+
+// a file imported from several places is only declared the first time it's reached
+void Parser::remove_repeated_imports(SourceFile *source_file, std::set<std::string> &seen) {
+    auto &imports = source_file->imports();
+
+    for (auto it = imports.begin(); it != imports.end();) {
+        if (seen.insert((*it)->name()).second) {
+            remove_repeated_imports(it->get(), seen);
+            ++it;
+        } else {
+            it = imports.erase(it);
+        }
+    }
 }
 
 Token Parser::front_token() {
@@ -112,6 +196,9 @@ bool Parser::next_token() {
 }
 
 bool Parser::fill_token() {
+    // the pair a blank line leaves can be split across two reads from the scanner
+    collapse_deindent_indent_tokens();
+
     if (m_tokens.size() < 2 && !next_token()) {
         return false;
     }
@@ -213,7 +300,7 @@ std::unique_ptr<Block> Parser::read_block(bool read_end) {
     return_null_if_false(skip_token(Token::Deindent));
 
     if (read_end) {
-        return_null_if_false(skip_keyword("End"));
+        return_null_if_false(skip_keyword("end"));
     }
 
     return std::make_unique<Block>(block_token, std::move(expressions));
@@ -232,6 +319,17 @@ std::unique_ptr<Node> Parser::read_expression(bool parse_comma) {
         auto unary_expression = read_unary_expression(parse_comma);
         return_null_if_null(unary_expression);
 
+        // a variable or a field of one can be given a new value
+        if (is_token(Token::Assignment) && (llvm::isa<ParamName>(unary_expression.get()) || llvm::isa<Selector>(unary_expression.get()))) {
+            Token assignment_token;
+            return_null_if_false(read_token(Token::Assignment, assignment_token));
+
+            auto rhs = read_expression(true);
+            return_null_if_null(rhs);
+
+            return std::make_unique<Assignment>(assignment_token, std::move(unary_expression), std::move(rhs));
+        }
+
         if (is_token(Token::Operator) || is_token(Token::Assignment)) {
             return read_binary_expression(std::move(unary_expression), 0);
         } else {
@@ -600,13 +698,9 @@ std::unique_ptr<While> Parser::read_while() {
     auto condition = read_expression(true);
     return_null_if_null(condition);
 
-    return_null_if_false(skip_token(Token::Newline));
-    return_null_if_false(skip_token(Token::Indent));
-
-    auto body = read_expression();
+    auto body = read_block(false);
     return_null_if_null(body);
 
-    return_null_if_false(skip_token(Token::Deindent));
     return_null_if_false(skip_keyword("end"));
 
     return std::make_unique<While>(
@@ -614,61 +708,28 @@ std::unique_ptr<While> Parser::read_while() {
     );
 }
 
-std::unique_ptr<Block> Parser::read_for() {
-    /*
-     * for item in blah
-     *
-     * let iterator = iterate(blah)
-     * while True
-     *     let maybe_item = next(iterator)
-     *     if item = maybe_item
-     *         <code>
-     *     else
-     *         break
-     */
+std::unique_ptr<For> Parser::read_for() {
+    Token for_token;
+    return_null_if_false(read_keyword("for", for_token));
 
-    return_null_if_false(read_keyword("for", token));
+    auto name = read_decl_name();
+    return_null_if_null(name);
 
-    auto variable = read_name();
-    return_null_if_null(variable);
+    auto variable = std::make_unique<VarDecl>(for_token, std::move(name), nullptr, false);
 
     return_null_if_false(skip_keyword("in"));
 
-    auto iterator = read_expression(true);
-    return_null_if_null(iterator);
-
-    return_null_if_false(skip_token(Token::Newline));
-
-    auto loop_code = read_block();
-    return_null_if_null(loop_code);
-
-    std::string for_id;
-    std::stringstream ss;
-    ss << &token;
-    ss >> for_id;
-
-    std::string state_variable_name = "state_" + for_id;
-    std::string next_state_variable_name = "next_state_" + for_id;
-
-    /*auto code_block = new Block(token);
-
-    auto state_variable = std::make_unique<Let>(token, state_variable_name, new Call(token, "start", std::move(iterator)));
-    code_block->add_expression(std::move(state_variable));
+    auto iterable = read_expression(true);
+    return_null_if_null(iterable);
 
-    auto condition = new Call(token, "not", new Call(token, "done", iterator, static_cast<VarDecl *>(&state_variable->assignment->lhs())->name()));
-    auto while_code = new While(token, condition, std::move(loop_code));
-
-    auto next_state_variable = new Let(token, next_state_variable_name, new Call(token, "next", iterator, static_cast<VarDecl *>(&state_variable->assignment->lhs())->name()));
-    loop_code->insert_expression(0, next_state_variable);
-    loop_code->insert_expression(1, new Assignment(token, static_cast<VarDecl *>(&state_variable->assignment->lhs()), new Selector(token, static_cast<VarDecl *>(&next_state_variable->assignment->lhs())->name(), "1")));
-    loop_code->insert_expression(1, new Assignment(token, new VarDecl(token, new Name(token, next_state_variable_name), nullptr, false), new Selector(token, static_cast<VarDecl *>(&next_state_variable->assignment->lhs())->name(), "0")));
-
-    code_block->add_expression(while_code);
+    auto body = read_block(false);
+    return_null_if_null(body);
 
-    return code_block;*/
+    return_null_if_false(skip_keyword("end"));
 
-    std::vector<std::unique_ptr<Node>> expressions;
-    return std::make_unique<Block>(token, std::move(expressions));
+    return std::make_unique<For>(
+        for_token, std::move(variable), std::move(iterable), std::move(body)
+    );
 }
 
 std::unique_ptr<If> Parser::read_if() {
@@ -698,22 +759,20 @@ std::unique_ptr<If> Parser::read_if() {
 
     return_null_if_null(condition);
 
-    return_null_if_false(skip_token(Token::Indent));
-
     m_logger.debug("Reading if true case");
 
-    auto true_case = read_expression();
-    std::unique_ptr<Node> false_case;
+    auto true_case = read_block(false);
+    return_null_if_null(true_case);
 
-    return_null_if_false(skip_token(Token::Deindent));
+    std::unique_ptr<Node> false_case;
 
     if (is_and_skip_keyword("else")) {
         if (is_keyword("if")) {
             false_case = read_if();
         } else {
-            return_null_if_false(skip_token(Token::Indent));
-            false_case = read_expression();
-            return_null_if_false(skip_deindent_and_end_token());
+            false_case = read_block(false);
+            return_null_if_null(false_case);
+            return_null_if_false(skip_keyword("end"));
         }
     } else {
         return_null_if_false(skip_keyword("end")); // deindent was handled before the else
@@ -765,16 +824,15 @@ std::unique_ptr<Case> Parser::read_case() {
         } else {
             assignment = read_expression(true);
         }
-    }
 
-    return_null_if_null(assignment);
-    return_null_if_false(skip_token(Token::Newline));
+        return_null_if_null(assignment);
+    }
 
     auto code = read_block(false);
     return_null_if_null(code);
 
     return std::make_unique<Case>(
-        token, std::move(condition), std::move(assignment), std::move(code)
+        case_token, std::move(condition), std::move(assignment), std::move(code)
     );
 }
 
@@ -785,7 +843,7 @@ std::unique_ptr<Switch> Parser::read_switch() {
     auto expression = read_expression(true);
     return_null_if_null(expression);
 
-    return_null_if_false(skip_token(Token::Newline));
+    return_null_if_false(skip_token(Token::Indent));
 
     std::vector<std::unique_ptr<Case>> cases;
     while (is_keyword("case")) {
@@ -795,15 +853,15 @@ std::unique_ptr<Switch> Parser::read_switch() {
     }
 
     std::unique_ptr<Block> default_block;
-    if (is_keyword("default")) {
+    if (is_and_skip_keyword("default")) {
         default_block = read_block(false);
         return_null_if_null(default_block);
     }
 
-    return_null_if_false(skip_keyword("end"));
+    return_null_if_false(skip_deindent_and_end_token());
 
     return std::make_unique<Switch>(
-        token, std::move(expression), std::move(cases), std::move(default_block)
+        switch_token, std::move(expression), std::move(cases), std::move(default_block)
     );
 }
 
@@ -989,12 +1047,9 @@ std::unique_ptr<DefDecl> Parser::read_def_decl() {
     std::unique_ptr<Block> block;
 
     if (!builtin) {
-        return_null_if_false(skip_token(Token::Indent));
-        auto body = read_expression();
-        return_null_if_null(body);
-        return_null_if_false(skip_deindent_and_end_token());
-
-        block = std::make_unique<Block>(body->token(), std::move(body));
+        block = read_block(false);
+        return_null_if_null(block);
+        return_null_if_false(skip_keyword("end"));
     }
 
     return std::make_unique<DefDecl>(
@@ -5,12 +5,16 @@
 #include <boost/regex/icu.hpp>
 #include <unicode/unistr.h>
 
+#include "acorn/statistics.h"
+
 #include "acorn/parser/scanner.h"
 
 using namespace acorn;
 using namespace acorn::diagnostics;
 using namespace acorn::parser;
 
+static statistics::Counter token_count("tokens", "tokens scanned");
+
 Scanner::Scanner(std::string filename) : m_logger("acorn.scanner"), m_filename(filename) {
     std::ifstream stream;
     stream.open(filename.c_str());
@@ -115,6 +119,8 @@ bool Scanner::next_token(Token &token) {
 
     m_logger.trace("{}", token);
 
+    ++token_count;
+
     return true;
 }
 
@@ -0,0 +1,293 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <llvm/ADT/StringRef.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "acorn/server.h"
+
+using namespace acorn;
+using namespace acorn::server;
+
+// the length prefix comes from the peer, so it's checked against something no real request or response reaches
+// before anything is allocated for it
+static const uint32_t max_message_size = 16 * 1024 * 1024;
+
+// how long a peer may stall in the middle of sending or receiving a message before it's given up on
+static const time_t socket_timeout_seconds = 10;
+
+static bool write_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        auto written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            return false;
+        }
+
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+static bool read_all(int fd, char *data, size_t size) {
+    while (size > 0) {
+        auto bytes_read = read(fd, data, size);
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        } else if (bytes_read <= 0) {
+            return false;
+        }
+
+        data += bytes_read;
+        size -= bytes_read;
+    }
+
+    return true;
+}
+
+static bool write_message(int fd, const std::string &message) {
+    uint32_t size = message.size();
+    return write_all(fd, reinterpret_cast<const char *>(&size), sizeof(size)) &&
+           write_all(fd, message.data(), message.size());
+}
+
+static bool read_message(int fd, std::string &message) {
+    uint32_t size;
+    if (!read_all(fd, reinterpret_cast<char *>(&size), sizeof(size))) {
+        return false;
+    }
+
+    if (size > max_message_size) {
+        return false;
+    }
+
+    message.resize(size);
+    return read_all(fd, &message[0], size);
+}
+
+static bool make_address(const std::string &socket_path, sockaddr_un &address) {
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    return true;
+}
+
+static bool is_listening(const sockaddr_un &address) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool listening = connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+    close(fd);
+
+    return listening;
+}
+
+static void set_timeouts(int fd) {
+    timeval timeout;
+    timeout.tv_sec = socket_timeout_seconds;
+    timeout.tv_usec = 0;
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+std::string Request::encode() const {
+    std::stringstream ss;
+    ss << working_directory << "\n";
+    ss << filename << "\n";
+    ss << output_filename << "\n";
+    ss << target << "\n";
+    ss << cache_directory << "\n";
+    ss << static_cast<int>(emit_kind) << "\n";
+    ss << optimisation_level << "\n";
+    ss << size_level << "\n";
+    ss << jobs << "\n";
+    return ss.str();
+}
+
+bool Request::decode(const std::string &data) {
+    std::stringstream ss(data);
+
+    std::getline(ss, working_directory);
+    std::getline(ss, filename);
+    std::getline(ss, output_filename);
+    std::getline(ss, target);
+    std::getline(ss, cache_directory);
+
+    int emit_kind_value;
+    ss >> emit_kind_value >> optimisation_level >> size_level >> jobs;
+    emit_kind = static_cast<compiler::EmitKind>(emit_kind_value);
+
+    return !ss.fail();
+}
+
+std::string Response::encode() const {
+    return std::to_string(exit_code) + "\n" + diagnostics;
+}
+
+bool Response::decode(const std::string &data) {
+    auto lines = llvm::StringRef(data).split('\n');
+    if (lines.first.getAsInteger(10, exit_code)) {
+        return false;
+    }
+
+    diagnostics = lines.second;
+    return true;
+}
+
+Server::Server(std::string socket_path) : m_logger("acorn.server"), m_socket_path(socket_path) {
+
+}
+
+int Server::serve() {
+    sockaddr_un address;
+    if (!make_address(m_socket_path, address)) {
+        m_logger.error("socket path is too long: {}", m_socket_path);
+        return 1;
+    }
+
+    // only a stale socket may be replaced, never one another server is still answering on
+    if (is_listening(address)) {
+        m_logger.error("a server is already listening on {}", m_socket_path);
+        return 1;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        m_logger.error("unable to create socket: {}", std::strerror(errno));
+        return 1;
+    }
+
+    // a previous server that didn't shut down cleanly leaves its socket behind
+    unlink(m_socket_path.c_str());
+
+    // the server compiles whatever it's sent with the user's permissions, so only the user may connect to it
+    auto previous_umask = umask(0077);
+    bool bound = bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+    umask(previous_umask);
+
+    if (!bound || chmod(m_socket_path.c_str(), 0600) < 0 || listen(listen_fd, 16) < 0) {
+        m_logger.error("unable to listen on {}: {}", m_socket_path, std::strerror(errno));
+        close(listen_fd);
+        return 1;
+    }
+
+    // a client going away mid response shouldn't take the server with it
+    signal(SIGPIPE, SIG_IGN);
+
+    m_logger.info("listening on {}", m_socket_path);
+
+    while (true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            m_logger.error("unable to accept connection: {}", std::strerror(errno));
+            break;
+        }
+
+        set_timeouts(fd);
+        handle_connection(fd);
+        close(fd);
+    }
+
+    close(listen_fd);
+    unlink(m_socket_path.c_str());
+
+    return 1;
+}
+
+void Server::handle_connection(int fd) {
+    std::string message;
+    Request request;
+    if (!read_message(fd, message) || !request.decode(message)) {
+        m_logger.warn("ignoring malformed request");
+        return;
+    }
+
+    write_message(fd, compile(request).encode());
+}
+
+Response Server::compile(const Request &request) {
+    m_logger.info("compiling {} in {}", request.filename, request.working_directory);
+
+    compiler::Compiler compiler(&m_session);
+    compiler.set_working_directory(request.working_directory);
+    compiler.set_optimisation_level(request.optimisation_level, request.size_level);
+    compiler.set_jobs(request.jobs);
+    compiler.set_target(request.target);
+    compiler.set_cache_directory(request.cache_directory);
+    compiler.set_emit_kind(request.emit_kind);
+    compiler.set_output_filename(request.output_filename);
+
+    // errors are reported on std::cerr, which the client should see rather than the server
+    std::stringstream diagnostics;
+    auto cerr_buffer = std::cerr.rdbuf(diagnostics.rdbuf());
+
+    Response response;
+    response.exit_code = compiler.parse_and_compile(request.filename);
+
+    std::cerr.rdbuf(cerr_buffer);
+
+    response.diagnostics = diagnostics.str();
+    return response;
+}
+
+int server::send_request(const std::string &socket_path, const Request &request) {
+    diagnostics::Logger logger("acorn.client");
+
+    sockaddr_un address;
+    if (!make_address(socket_path, address)) {
+        logger.error("socket path is too long: {}", socket_path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        logger.error("unable to connect to {}: {}", socket_path, std::strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    std::string message;
+    bool ok = write_message(fd, request.encode()) && read_message(fd, message);
+    close(fd);
+
+    if (!ok) {
+        logger.error("lost connection to {}", socket_path);
+        return -1;
+    }
+
+    Response response;
+    if (!response.decode(message)) {
+        logger.error("malformed response from {}", socket_path);
+        return -1;
+    }
+
+    std::cerr << response.diagnostics;
+
+    return response.exit_code;
+}
@@ -0,0 +1,137 @@
+#include <llvm/ADT/StringMap.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/PassRegistry.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetOptions.h>
+
+#include "acorn/session.h"
+
+using namespace acorn;
+using namespace acorn::session;
+
+// types and constants pile up in a context, so one is only reused this many times
+static const unsigned int max_context_uses = 64;
+
+Session::Session() : m_logger("acorn.session"), m_all_targets_initialised(false) {
+    // other targets are only registered when a compile asks for one
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+
+    auto registry = llvm::PassRegistry::getPassRegistry();
+    llvm::initializeCore(*registry);
+    llvm::initializeCodeGen(*registry);
+    llvm::initializeLoopStrengthReducePass(*registry);
+    llvm::initializeLowerIntrinsicsPass(*registry);
+}
+
+Target *Session::get_target(const std::string &triple, const std::string &cpu, const std::string &features,
+                            llvm::CodeGenOpt::Level optimisation_level) {
+    auto key = triple + ";" + cpu + ";" + features + ";" + std::to_string(optimisation_level);
+
+    auto it = m_targets.find(key);
+    if (it != m_targets.end()) {
+        return it->second.get();
+    }
+
+    auto machine = create_target_machine(triple, cpu, features, optimisation_level);
+    if (machine == nullptr) {
+        return nullptr;
+    }
+
+    auto data_layout = machine->createDataLayout();
+    auto target = new Target { std::move(machine), data_layout };
+    m_targets[key] = std::unique_ptr<Target>(target);
+
+    return target;
+}
+
+std::unique_ptr<llvm::TargetMachine> Session::create_target_machine(const std::string &triple, const std::string &cpu,
+                                                                    const std::string &features,
+                                                                    llvm::CodeGenOpt::Level optimisation_level) {
+    std::string error;
+    const auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (target == nullptr) {
+        m_logger.error("unable to target {}: {}", triple, error);
+        return nullptr;
+    }
+
+    llvm::TargetOptions target_options;
+
+    return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+        triple, cpu, features, target_options,
+        llvm::Reloc::DynamicNoPIC, llvm::CodeModel::Small, optimisation_level
+    ));
+}
+
+const std::string &Session::host_cpu_name() {
+    if (m_host_cpu_name.empty()) {
+        m_host_cpu_name = llvm::sys::getHostCPUName();
+    }
+
+    return m_host_cpu_name;
+}
+
+const std::string &Session::host_cpu_features() {
+    if (m_host_cpu_features.empty()) {
+        llvm::SubtargetFeatures features;
+
+        llvm::StringMap<bool> host_features;
+        llvm::sys::getHostCPUFeatures(host_features);
+        for (auto &it : host_features) {
+            features.AddFeature(it.first(), it.second);
+        }
+
+        m_host_cpu_features = features.getString();
+    }
+
+    return m_host_cpu_features;
+}
+
+void Session::initialise_all_targets() {
+    if (m_all_targets_initialised) {
+        return;
+    }
+
+#define ACORN_TARGET(name) \
+    LLVMInitialize##name##TargetInfo(); \
+    LLVMInitialize##name##Target(); \
+    LLVMInitialize##name##TargetMC(); \
+    LLVMInitialize##name##AsmPrinter();
+#define ACORN_ASM_PARSER(name) \
+    LLVMInitialize##name##AsmParser();
+#include "acorn/targets.def"
+
+    m_all_targets_initialised = true;
+}
+
+std::unique_ptr<llvm::LLVMContext> Session::acquire_context() {
+    if (m_contexts.empty()) {
+        return std::make_unique<llvm::LLVMContext>();
+    }
+
+    auto context = std::move(m_contexts.back());
+    m_contexts.pop_back();
+
+    return context;
+}
+
+void Session::release_context(std::unique_ptr<llvm::LLVMContext> context) {
+    auto uses = ++m_context_uses[context.get()];
+    if (uses >= max_context_uses) {
+        m_context_uses.erase(context.get());
+        return;
+    }
+
+    m_contexts.push_back(std::move(context));
+}
+
+ContextLease::ContextLease(Session *session) : m_session(session), m_context(session->acquire_context()) {
+
+}
+
+ContextLease::~ContextLease() {
+    m_session->release_context(std::move(m_context));
+}
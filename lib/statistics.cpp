@@ -0,0 +1,138 @@
+#include <sys/resource.h>
+
+#include <llvm/Support/Format.h>
+#include <llvm/Support/Timer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "acorn/statistics.h"
+
+using namespace acorn;
+using namespace acorn::statistics;
+
+static std::vector<Counter *> &get_counters() {
+    static std::vector<Counter *> counters;
+    return counters;
+}
+
+static uint64_t get_peak_rss() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+Counter::Counter(const char *name, const char *description) :
+    m_name(name), m_description(description), m_value(0) {
+    get_counters().push_back(this);
+}
+
+Statistics::Statistics() : m_in_phase(false) {
+    reset();
+}
+
+void Statistics::reset() {
+    m_phases.clear();
+    m_in_phase = false;
+
+    // counters are process wide, so only report what happened since the last reset
+    m_counter_baselines.clear();
+    for (auto counter : get_counters()) {
+        m_counter_baselines.push_back(counter->value());
+    }
+}
+
+void Statistics::begin_phase(std::string name) {
+    if (m_in_phase) {
+        end_phase();
+    }
+
+    auto now = llvm::TimeRecord::getCurrentTime(true);
+
+    m_current_phase.name = name;
+    m_current_phase.wall_time = -now.getWallTime();
+    m_current_phase.user_time = -now.getUserTime();
+    m_current_phase.system_time = -now.getSystemTime();
+    m_in_phase = true;
+}
+
+void Statistics::end_phase() {
+    if (!m_in_phase) {
+        return;
+    }
+
+    auto now = llvm::TimeRecord::getCurrentTime(false);
+
+    m_current_phase.wall_time += now.getWallTime();
+    m_current_phase.user_time += now.getUserTime();
+    m_current_phase.system_time += now.getSystemTime();
+    m_current_phase.peak_rss = get_peak_rss();
+
+    m_phases.push_back(m_current_phase);
+    m_in_phase = false;
+}
+
+void Statistics::print_table(llvm::raw_ostream &os) const {
+    double total_wall_time = 0;
+    double total_cpu_time = 0;
+
+    os << "phase              wall (s)    cpu (s)  peak rss (MB)\n";
+    for (auto &phase : m_phases) {
+        auto cpu_time = phase.user_time + phase.system_time;
+        os << llvm::left_justify(phase.name, 16);
+        os << llvm::format(" %10.4f %10.4f %14.1f\n", phase.wall_time, cpu_time, phase.peak_rss / (1024.0 * 1024.0));
+
+        total_wall_time += phase.wall_time;
+        total_cpu_time += cpu_time;
+    }
+    os << llvm::left_justify("total", 16);
+    os << llvm::format(" %10.4f %10.4f\n", total_wall_time, total_cpu_time);
+
+    os << "\n";
+
+    auto &counters = get_counters();
+    for (size_t i = 0; i < counters.size(); i++) {
+        os << llvm::format("%12llu %s\n", static_cast<unsigned long long>(get_counter_value(i)),
+                           counters[i]->description());
+    }
+}
+
+void Statistics::print_json(llvm::raw_ostream &os) const {
+    os << "{\n  \"phases\": [";
+    for (size_t i = 0; i < m_phases.size(); i++) {
+        auto &phase = m_phases[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    {\"name\": \"" << phase.name << "\"";
+        os << llvm::format(", \"wall_time\": %.6f", phase.wall_time);
+        os << llvm::format(", \"user_time\": %.6f", phase.user_time);
+        os << llvm::format(", \"system_time\": %.6f", phase.system_time);
+        os << ", \"peak_rss\": " << phase.peak_rss << "}";
+    }
+    os << "\n  ],\n  \"counters\": {";
+
+    auto &counters = get_counters();
+    for (size_t i = 0; i < counters.size(); i++) {
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    \"" << counters[i]->name() << "\": " << get_counter_value(i);
+    }
+    os << "\n  }\n}\n";
+}
+
+uint64_t Statistics::get_counter_value(size_t index) const {
+    // counters constructed after the last reset started from zero
+    auto baseline = index < m_counter_baselines.size() ? m_counter_baselines[index] : 0;
+    return get_counters()[index]->value() - baseline;
+}
+
+ScopedPhase::ScopedPhase(Statistics &statistics, std::string name) : m_statistics(statistics) {
+    m_statistics.begin_phase(name);
+}
+
+ScopedPhase::~ScopedPhase() {
+    m_statistics.end_phase();
+}
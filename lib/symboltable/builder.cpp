@@ -73,6 +73,23 @@ void Builder::visit_parameter(ast::Parameter *node) {
     scope()->insert(this, node, std::move(symbol));
 }
 
+void Builder::visit_for(ast::For *node) {
+    visit_node(node->iterable().get());
+
+    // the loop variable is only in scope in the loop, so each loop gets an unnamed scope
+    auto pointer_location = reinterpret_cast<std::uintptr_t>(node);
+    std::stringstream ss;
+    ss << pointer_location;
+
+    auto symbol = new Symbol(ss.str(), false);
+    scope()->insert(this, node, std::unique_ptr<Symbol>(symbol));
+
+    push_scope(symbol);
+    visit_node(node->variable().get());
+    visit_node(node->body().get());
+    pop_scope();
+}
+
 void Builder::visit_def_decl(ast::DefDecl *node) {
     auto name = node->name();
 
@@ -3,6 +3,7 @@
 
 #include "acorn/ast/nodes.h"
 #include "acorn/diagnostics.h"
+#include "acorn/statistics.h"
 #include "acorn/symboltable/namespace.h"
 #include "acorn/typesystem/types.h"
 
@@ -12,13 +13,17 @@ using namespace acorn;
 using namespace acorn::diagnostics;
 using namespace acorn::symboltable;
 
+static statistics::Counter symbol_count("symbols", "symbols defined");
+
 Symbol::Symbol(std::string name, bool builtin) :
     m_name(name),
     m_builtin(builtin),
     m_type(nullptr),
     m_llvm_value(nullptr),
     m_scope(nullptr),
-    m_node(nullptr) { }
+    m_node(nullptr) {
+    ++symbol_count;
+}
 
 Symbol::Symbol(ast::Name *name, bool builtin) :
     Symbol(name->value(), builtin) { }
@@ -4,6 +4,7 @@
 
 #include "acorn/ast/nodes.h"
 #include "acorn/diagnostics.h"
+#include "acorn/statistics.h"
 #include "acorn/symboltable/namespace.h"
 #include "acorn/symboltable/symbol.h"
 #include "acorn/typesystem/types.h"
@@ -15,6 +16,8 @@ using namespace acorn;
 using namespace acorn::diagnostics;
 using namespace acorn::typesystem;
 
+static statistics::Counter specialisation_count("specialisations", "generic method specialisations");
+
 TypeChecker::TypeChecker(symboltable::Namespace *scope) :
     ast::Visitor("acorn.typechecker") {
     push_scope(scope);
@@ -97,6 +100,10 @@ typesystem::Type *TypeChecker::builtin_type_from_name(ast::DeclName *node) {
         return new typesystem::FloatType(128);
     } else if (name == "UnsafePointer") {
         return new typesystem::UnsafePointerType();
+    } else if (name == "Task") {
+        return new typesystem::TaskType();
+    } else if (name == "Dictionary") {
+        return new typesystem::DictionaryType();
     } else if (name == "Function") {
         return new typesystem::FunctionType();
     } else if (name == "Method") {
@@ -111,12 +118,13 @@ typesystem::Type *TypeChecker::builtin_type_from_name(ast::DeclName *node) {
     }
 }
 
-bool TypeChecker::infer_call_type_parameters(ast::Call *call, std::vector<typesystem::Type *> parameter_types, std::vector<typesystem::Type *> argument_types) {
+bool TypeChecker::infer_call_type_parameters(ast::Call *call, llvm::ArrayRef<typesystem::Type *> parameter_types, llvm::ArrayRef<typesystem::Type *> argument_types) {
     assert(parameter_types.size() == argument_types.size());
 
-    int i = 0;
-    for (auto t : parameter_types) {
-        auto inferred_type_parameters = call->inferred_type_parameters();
+    auto &inferred_type_parameters = call->inferred_type_parameters();
+
+    for (size_t i = 0; i < parameter_types.size(); i++) {
+        auto t = parameter_types[i];
 
         auto dt = dynamic_cast<typesystem::Parameter *>(t);
         if (dt != nullptr) {
@@ -145,13 +153,26 @@ bool TypeChecker::infer_call_type_parameters(ast::Call *call, std::vector<typesy
                 }
             }
         }
-
-        i++;
     }
 
     return true;
 }
 
+std::string TypeChecker::specialisation_cache_key(const std::vector<typesystem::Type *> &argument_types) const {
+    std::stringstream ss;
+
+    for (auto type : argument_types) {
+        // abstract types (parameters, type descriptions) share mangled names, so they can't be cached
+        if (type->is_abstract()) {
+            return "";
+        }
+
+        ss << type->mangled_name() << ";";
+    }
+
+    return ss.str();
+}
+
 typesystem::Type *TypeChecker::replace_type_parameters(typesystem::Type *type, std::map<typesystem::ParameterType *, typesystem::Type *> replacements) {
     auto parameter = dynamic_cast<typesystem::Parameter *>(type);
     if (parameter != nullptr) {
@@ -190,6 +211,23 @@ void TypeChecker::check_not_null(ast::Node *node) {
     }
 }
 
+// dictionaries hash and compare their keys as raw bytes, so only types with no padding and
+// one representation for every value will do, plus strings, which are compared by contents
+void TypeChecker::check_dictionary_key_type(ast::Node *node, typesystem::Type *key_type) {
+    if (dynamic_cast<typesystem::Integer *>(key_type) != nullptr ||
+            dynamic_cast<typesystem::UnsignedInteger *>(key_type) != nullptr ||
+            dynamic_cast<typesystem::UnsafePointer *>(key_type) != nullptr) {
+        return;
+    }
+
+    auto string_type = instance_type(node, "String");
+    if (string_type != nullptr && string_type->is_compatible(key_type)) {
+        return;
+    }
+
+    report(TypeMismatchError(node, key_type->name(), "an integer, pointer or String"));
+}
+
 void TypeChecker::visit_node(ast::Node *node) {
     ast::Visitor::visit_node(node);
     check_not_null(node);
@@ -220,7 +258,13 @@ void TypeChecker::visit_name(ast::Name *node) {
 
 void TypeChecker::visit_type_name(ast::TypeName *node) {
     ast::Visitor::visit_type_name(node);
-    node->copy_type_from(node->name());
+
+    // the name alone is the unparameterised constructor, e.g. for a record field of type UnsafePointer{T}
+    if (node->parameters().empty()) {
+        node->copy_type_from(node->name());
+    } else {
+        node->set_type(find_type(node));
+    }
 }
 
 void TypeChecker::visit_param_name(ast::ParamName *node) {
@@ -280,10 +324,12 @@ void TypeChecker::visit_list(ast::List *node) {
     }
 
     if (types.size() == 1) {
-        std::vector<typesystem::Type *> p;
-        p.push_back(types[0]);
-        auto array_type = find_type(node, "Array")->with_parameters(p);
-        node->set_type(array_type->create(this, node));
+        auto array_type = find_type(node, "Array");
+        return_if_null(array_type);
+
+        // Array is parameterised by the type of its elements, not by an element
+        std::vector<typesystem::TypeType *> parameters = { types[0]->type() };
+        node->set_type(array_type->with_parameters(parameters)->create(this, node));
     } else {
         // FIXME show error
         node->set_type(nullptr);
@@ -304,7 +350,30 @@ void TypeChecker::visit_tuple(ast::Tuple *node) {
 }
 
 void TypeChecker::visit_dictionary(ast::Dictionary *node) {
-    report(TypeInferenceError(node));
+    ast::Visitor::visit_dictionary(node);
+
+    // an empty literal has nothing to infer the key and value types from
+    if (!node->has_elements()) {
+        report(TypeInferenceError(node));
+        return;
+    }
+
+    auto keys = node->keys();
+    auto values = node->values();
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        return_if_null_type(keys[i]);
+        return_if_null_type(values[i]);
+
+        if (i > 0) {
+            check_types(keys[0], keys[i]);
+            check_types(values[0], values[i]);
+        }
+    }
+
+    check_dictionary_key_type(keys[0], keys[0]->type());
+
+    node->set_type(new typesystem::Dictionary(keys[0]->type(), values[0]->type()));
 }
 
 void TypeChecker::visit_call(ast::Call *node) {
@@ -352,22 +421,42 @@ void TypeChecker::visit_call(ast::Call *node) {
     node->set_method_index(function->index_of(method));
 
     if (method->is_abstract()) {
-        if (!infer_call_type_parameters(node, method->parameter_types(), method->ordered_argument_types(node))) {
-            m_logger.critical("Could not infer type parameters.");
-            return;
+        auto argument_types = method->ordered_argument_types(node);
+
+        auto cache_key = std::make_pair(method, specialisation_cache_key(argument_types));
+        auto it = cache_key.second.empty() ? m_specialisation_cache.end() : m_specialisation_cache.find(cache_key);
+
+        if (it != m_specialisation_cache.end()) {
+            node->set_inferred_type_parameters(method->generic_specialisations()[it->second]);
+            node->set_method_specialisation_index(it->second);
+        } else {
+            if (!infer_call_type_parameters(node, method->parameter_types(), argument_types)) {
+                m_logger.critical("Could not infer type parameters.");
+                return;
+            }
+
+            node->set_method_specialisation_index(method->no_generic_specialisation());
+            method->add_generic_specialisation(node->inferred_type_parameters());
+            ++specialisation_count;
+
+            if (!cache_key.second.empty()) {
+                m_specialisation_cache[cache_key] = node->get_method_specialisation_index();
+            }
         }
 
         auto return_type = replace_type_parameters(
             method->return_type(), node->inferred_type_parameters()
         );
 
-        node->set_method_specialisation_index(method->no_generic_specialisation());
-        method->add_generic_specialisation(node->inferred_type_parameters());
-
         node->set_type(return_type);
     } else {
         node->set_type(method->return_type());
     }
+
+    auto dictionary = dynamic_cast<typesystem::Dictionary *>(node->type());
+    if (dictionary != nullptr) {
+        check_dictionary_key_type(node, dictionary->key_type());
+    }
 }
 
 void TypeChecker::visit_ccall(ast::CCall *node) {
@@ -388,7 +477,12 @@ void TypeChecker::visit_cast(ast::Cast *node) {
 }
 
 void TypeChecker::visit_assignment(ast::Assignment *node) {
-    auto symbol = scope()->lookup(this, node->lhs()->name());
+    if (node->declaration() == nullptr) {
+        visit_reassignment(node);
+        return;
+    }
+
+    auto symbol = scope()->lookup(this, node->declaration()->name());
     return_if_null(symbol);
 
     auto rhs = node->rhs();
@@ -398,7 +492,7 @@ void TypeChecker::visit_assignment(ast::Assignment *node) {
         return_if_null_type(rhs);
     }
 
-    auto lhs = node->lhs();
+    auto lhs = node->declaration();
 
     visit_node(lhs);
     if (!lhs->has_type()) {
@@ -418,6 +512,41 @@ void TypeChecker::visit_assignment(ast::Assignment *node) {
     symbol->copy_type_from(node);
 }
 
+void TypeChecker::visit_reassignment(ast::Assignment *node) {
+    auto rhs = node->rhs();
+    visit_node(rhs);
+    return_if_null_type(rhs);
+
+    auto lhs = node->lhs();
+    visit_node(lhs);
+    return_if_null_type(lhs);
+
+    // only variables and record fields hold values that can be replaced
+    auto type = lhs->type();
+    bool is_constant = dynamic_cast<typesystem::Function *>(type) != nullptr ||
+                       dynamic_cast<typesystem::TypeType *>(type) != nullptr ||
+                       dynamic_cast<typesystem::ModuleType *>(type) != nullptr;
+
+    if (auto name = llvm::dyn_cast<ast::ParamName>(lhs)) {
+        auto symbol = scope()->lookup(this, name);
+        return_if_null(symbol);
+
+        is_constant = is_constant || symbol->builtin();
+    }
+
+    if (is_constant) {
+        report(ConstantAssignmentError(lhs));
+        return;
+    }
+
+    if (!lhs->has_compatible_type_with(rhs)) {
+        report(TypeMismatchError(rhs, lhs));
+        return;
+    }
+
+    node->copy_type_from(lhs);
+}
+
 void TypeChecker::visit_selector(ast::Selector *node) {
     if (!node->operand()) {
         return;
@@ -433,7 +562,8 @@ void TypeChecker::visit_selector(ast::Selector *node) {
     auto record = dynamic_cast<typesystem::Record *>(operand->type());
 
     if (module_type != nullptr) {
-        auto module_name = static_cast<ast::Name *>(operand);
+        // names are read as parameterised names, even without any parameters
+        auto module_name = llvm::cast<ast::ParamName>(operand);
 
         auto symbol = scope()->lookup(this, module_name);
         return_if_null(symbol);
@@ -468,11 +598,47 @@ void TypeChecker::visit_while(ast::While *node) {
     node->copy_type_from(node->body());
 }
 
+void TypeChecker::visit_for(ast::For *node) {
+    auto iterable = node->iterable().get();
+    visit_node(iterable);
+    return_if_null_type(iterable);
+
+    // there's no general iteration protocol yet, only what the code generator can count through
+    auto element_type = typesystem::get_loop_element_type(iterable->type());
+    if (element_type == nullptr) {
+        report(TypeMismatchError(iterable, iterable->type()->name(), "Range, Array or ArrayIterator"));
+        return;
+    }
+
+    auto loop_symbol = scope()->lookup_by_node(this, node);
+    return_if_null(loop_symbol);
+
+    push_scope(loop_symbol);
+
+    auto variable = node->variable().get();
+    auto symbol = scope()->lookup(this, variable->name());
+    if (symbol != nullptr) {
+        variable->set_type(element_type);
+        symbol->copy_type_from(variable);
+
+        visit_node(node->body().get());
+    }
+
+    pop_scope();
+
+    node->set_type(instance_type(node, "Void"));
+}
+
 void TypeChecker::visit_if(ast::If *node) {
     Visitor::visit_if(node);
 
     // FIXME return a union type
-    node->copy_type_from(node->true_case());
+    if (node->false_case()) {
+        node->copy_type_from(node->true_case());
+    } else {
+        // there's nothing to give when the condition is false
+        node->set_type(instance_type(node, "Void"));
+    }
 }
 
 void TypeChecker::visit_return(ast::Return *node) {
@@ -500,7 +666,28 @@ void TypeChecker::visit_return(ast::Return *node) {
 
 void TypeChecker::visit_spawn(ast::Spawn *node) {
     Visitor::visit_spawn(node);
-    node->copy_type_from(node->call().get());
+
+    auto call = node->call().get();
+    return_if_null_type(call);
+
+    // the task can outlive the caller's frame, so it can't be handed a pointer into it
+    auto function = dynamic_cast<typesystem::Function *>(call->operand()->type());
+    if (function != nullptr) {
+        auto method = function->get_method(call->get_method_index());
+
+        int i = 0;
+        for (auto argument : method->ordered_arguments(call)) {
+            auto parameter_type = method->parameter_types()[i];
+            if (method->is_parameter_inout(parameter_type)) {
+                report(TypeMismatchError(argument, "inout " + parameter_type->name(), parameter_type->name()));
+                return;
+            }
+
+            i++;
+        }
+    }
+
+    node->set_type(new typesystem::Task(call->type()));
 }
 
 void TypeChecker::visit_case(ast::Case *node) {
@@ -511,9 +698,32 @@ void TypeChecker::visit_case(ast::Case *node) {
 void TypeChecker::visit_switch(ast::Switch *node) {
     Visitor::visit_switch(node);
 
+    auto expression = node->expression().get();
+    return_if_null_type(expression);
+
+    // cases are compared with a single instruction, so only scalars can be switched on
+    auto type = expression->type();
+    if (dynamic_cast<typesystem::Integer *>(type) == nullptr &&
+        dynamic_cast<typesystem::UnsignedInteger *>(type) == nullptr &&
+        dynamic_cast<typesystem::Boolean *>(type) == nullptr &&
+        dynamic_cast<typesystem::Float *>(type) == nullptr) {
+        report(TypeMismatchError(expression, type->name(), "an integer, boolean or float"));
+        return;
+    }
+
+    for (auto &case_ : node->cases()) {
+        check_types(expression, case_->condition().get());
+    }
+
     // FIXME make this a union of the typesystem
 
-    node->copy_type_from(node->cases()[0].get());
+    if (!node->cases().empty()) {
+        node->copy_type_from(node->cases()[0].get());
+    } else if (node->default_case()) {
+        node->copy_type_from(node->default_case().get());
+    } else {
+        node->set_type(instance_type(node, "Void"));
+    }
 }
 
 void TypeChecker::visit_parameter(ast::Parameter *node) {
@@ -594,6 +804,14 @@ void TypeChecker::visit_def_decl(ast::DefDecl *node) {
         return;
     }
 
+    // a Void method can end with anything, as it's thrown away
+    if (!node->builtin() && node->return_type() && dynamic_cast<typesystem::Void *>(return_type) == nullptr) {
+        auto body = node->body().get();
+        if (body->has_type() && !return_type->is_compatible(body->type())) {
+            report(TypeMismatchError(body, node->return_type().get()));
+        }
+    }
+
     auto method = new typesystem::Method(parameter_types, return_type);
 
     for (size_t i = 0; i < parameter_types.size(); i++) {
@@ -671,7 +889,7 @@ void TypeChecker::visit_type_decl(ast::TypeDecl *node) {
             field_types.push_back(type_type);
         }
 
-        type = new typesystem::RecordType(input_parameters, field_names, field_types);
+        type = new typesystem::RecordType(node->name()->name()->value(), input_parameters, field_names, field_types);
     }
 
     node->set_type(type);
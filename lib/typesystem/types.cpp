@@ -4,6 +4,7 @@
 
 #include "acorn/ast/nodes.h"
 #include "acorn/diagnostics.h"
+#include "acorn/statistics.h"
 #include "acorn/typesystem/visitor.h"
 
 #include "acorn/typesystem/types.h"
@@ -12,9 +13,15 @@ using namespace acorn;
 using namespace acorn::diagnostics;
 using namespace acorn::typesystem;
 
-Type::Type() { }
+static statistics::Counter type_count("types", "types allocated");
 
-Type::Type(std::vector<Type *> parameters) : m_parameters(parameters) { }
+Type::Type() {
+    ++type_count;
+}
+
+Type::Type(std::vector<Type *> parameters) : m_parameters(parameters) {
+    ++type_count;
+}
 
 bool Type::is_compatible(const Type *other) const {
     auto name1 = name();
@@ -262,6 +269,108 @@ void UnsafePointerType::accept(Visitor *visitor) {
     visitor->visit(this);
 }
 
+TaskType::TaskType(TypeType *result_type) {
+    if (result_type) {
+        m_parameters.push_back(result_type);
+    }
+}
+
+std::string TaskType::name() const {
+    if (has_result_type()) {
+        return "TaskType{" + result_type()->name() + "}";
+    } else {
+        return "TaskType{?}";
+    }
+}
+
+bool TaskType::has_result_type() const {
+    return m_parameters.size() == 1 && m_parameters[0] != nullptr;
+}
+
+TypeType *TaskType::result_type() const {
+    auto t = dynamic_cast<typesystem::TypeType *>(m_parameters[0]);
+    assert(t);
+    return t;
+}
+
+Type *TaskType::create(diagnostics::Reporter *diagnostics, ast::Node *node) {
+    if (has_result_type()) {
+        return new Task(result_type()->create(diagnostics, node));
+    } else {
+        diagnostics->report(InvalidTypeParameters(node, m_parameters.size(), 1));
+        return nullptr;
+    }
+}
+
+TaskType *TaskType::with_parameters(std::vector<TypeType *> parameters) {
+    if (parameters.empty()) {
+        return new TaskType();
+    } else if (parameters.size() == 1) {
+        return new TaskType(parameters[0]);
+    } else {
+        return nullptr;
+    }
+}
+
+void TaskType::accept(Visitor *visitor) {
+    visitor->visit(this);
+}
+
+DictionaryType::DictionaryType() {
+}
+
+DictionaryType::DictionaryType(TypeType *key_type, TypeType *value_type) {
+    m_parameters.push_back(key_type);
+    m_parameters.push_back(value_type);
+}
+
+std::string DictionaryType::name() const {
+    if (has_key_and_value_types()) {
+        return "DictionaryType{" + key_type()->name() + ", " + value_type()->name() + "}";
+    } else {
+        return "DictionaryType{?, ?}";
+    }
+}
+
+bool DictionaryType::has_key_and_value_types() const {
+    return m_parameters.size() == 2 && m_parameters[0] != nullptr && m_parameters[1] != nullptr;
+}
+
+TypeType *DictionaryType::key_type() const {
+    auto t = dynamic_cast<typesystem::TypeType *>(m_parameters[0]);
+    assert(t);
+    return t;
+}
+
+TypeType *DictionaryType::value_type() const {
+    auto t = dynamic_cast<typesystem::TypeType *>(m_parameters[1]);
+    assert(t);
+    return t;
+}
+
+Type *DictionaryType::create(diagnostics::Reporter *diagnostics, ast::Node *node) {
+    if (has_key_and_value_types()) {
+        return new Dictionary(key_type()->create(diagnostics, node), value_type()->create(diagnostics, node));
+    } else {
+        diagnostics->report(InvalidTypeParameters(node, m_parameters.size(), 2));
+        return nullptr;
+    }
+}
+
+DictionaryType *DictionaryType::with_parameters(std::vector<TypeType *> parameters) {
+    if (parameters.empty()) {
+        return new DictionaryType();
+    } else if (parameters.size() == 2) {
+        return new DictionaryType(parameters[0], parameters[1]);
+    } else {
+        return nullptr;
+    }
+}
+
+void DictionaryType::accept(Visitor *visitor) {
+    visitor->visit(this);
+}
+
 FunctionType::FunctionType() {
 
 }
@@ -346,9 +455,11 @@ RecordType::RecordType() {
     m_constructor = new Function();
 }
 
-RecordType::RecordType(std::vector<ParameterType *> input_parameters,
+RecordType::RecordType(std::string declared_name,
+                       std::vector<ParameterType *> input_parameters,
                        std::vector<std::string> field_names,
                        std::vector<TypeType *> field_types) :
+        m_declared_name(declared_name),
         m_input_parameters(input_parameters),
         m_field_names(field_names),
         m_field_types(field_types)
@@ -357,11 +468,13 @@ RecordType::RecordType(std::vector<ParameterType *> input_parameters,
     create_builtin_constructor();
 }
 
-RecordType::RecordType(std::vector<ParameterType *> input_parameters,
+RecordType::RecordType(std::string declared_name,
+                       std::vector<ParameterType *> input_parameters,
                        std::vector<std::string> field_names,
                        std::vector<TypeType *> field_types,
                        std::vector<TypeType *> parameters) :
         TypeType(parameters),
+        m_declared_name(declared_name),
         m_input_parameters(input_parameters),
         m_field_names(field_names),
         m_field_types(field_types)
@@ -423,7 +536,7 @@ Type *RecordType::create(diagnostics::Reporter *diagnostics, ast::Node *node) {
             field_types.push_back(result);
         }
 
-        return new Record(m_field_names, field_types);
+        return new Record(m_field_names, field_types, m_declared_name);
     } else {
         diagnostics->report(InvalidTypeParameters(node, m_parameters.size(), m_input_parameters.size()));
         return nullptr;
@@ -431,7 +544,7 @@ Type *RecordType::create(diagnostics::Reporter *diagnostics, ast::Node *node) {
 }
 
 RecordType *RecordType::with_parameters(std::vector<TypeType *> parameters) {
-    return new RecordType(m_input_parameters, m_field_names, m_field_types, parameters);
+    return new RecordType(m_declared_name, m_input_parameters, m_field_names, m_field_types, parameters);
 }
 
 void RecordType::accept(Visitor *visitor) {
@@ -439,16 +552,21 @@ void RecordType::accept(Visitor *visitor) {
 }
 
 void RecordType::create_builtin_constructor() {
-    std::vector<Type *> field_types;
-
-    for (auto &type : m_field_types) {
-        auto result = type->create(nullptr, nullptr);
-        field_types.push_back(result);
+    // without parameters a generic record is constructed from its own, leaving them to be
+    // inferred from the arguments like any other generic method
+    auto record_type = this;
+    if (m_parameters.size() != m_input_parameters.size()) {
+        std::vector<TypeType *> parameters(m_input_parameters.begin(), m_input_parameters.end());
+        record_type = with_parameters(parameters);
     }
 
-    auto method = new Method(field_types, this->create(nullptr, nullptr));
+    auto record = static_cast<Record *>(record_type->create(nullptr, nullptr));
 
-    method->add_empty_specialisation();
+    auto method = new Method(record->field_types(), record);
+
+    if (!method->is_abstract()) {
+        method->add_empty_specialisation();
+    }
 
     for (size_t i = 0; i < m_field_names.size(); i++) {
         method->set_parameter_name(i, m_field_names[i]);
@@ -842,12 +960,116 @@ void UnsafePointer::accept(Visitor *visitor) {
     visitor->visit(this);
 }
 
-Record::Record(std::vector<std::string> field_names, std::vector<Type *> field_types) :
-        m_field_names(field_names)
+Task::Task(Type *result_type) {
+    m_parameters.push_back(result_type);
+}
+
+std::string Task::name() const {
+    std::stringstream ss;
+    ss << "Task{" << result_type()->name() << "}";
+    return ss.str();
+}
+
+std::string Task::mangled_name() const {
+    std::stringstream ss;
+    ss << "k" << result_type()->mangled_name();
+    return ss.str();
+}
+
+TaskType *Task::type() const {
+    return new TaskType();
+}
+
+Type *Task::result_type() const {
+    assert(m_parameters.size() == 1);
+    return m_parameters[0];
+}
+
+bool Task::is_compatible(const Type *other) const {
+    auto other_task = dynamic_cast<const Task *>(other);
+    if (other_task) {
+        return result_type()->is_compatible(other_task->result_type());
+    } else {
+        return false;
+    }
+}
+
+Task *Task::with_parameters(std::vector<Type *> parameters) {
+    if (parameters.size() == 1) {
+        return new Task(parameters[0]);
+    } else {
+        return nullptr;
+    }
+}
+
+void Task::accept(Visitor *visitor) {
+    visitor->visit(this);
+}
+
+Dictionary::Dictionary(Type *key_type, Type *value_type) {
+    m_parameters.push_back(key_type);
+    m_parameters.push_back(value_type);
+}
+
+std::string Dictionary::name() const {
+    std::stringstream ss;
+    ss << "Dictionary{" << key_type()->name() << ", " << value_type()->name() << "}";
+    return ss.str();
+}
+
+std::string Dictionary::mangled_name() const {
+    std::stringstream ss;
+    ss << "d" << key_type()->mangled_name() << value_type()->mangled_name();
+    return ss.str();
+}
+
+DictionaryType *Dictionary::type() const {
+    return new DictionaryType();
+}
+
+Type *Dictionary::key_type() const {
+    assert(m_parameters.size() == 2);
+    return m_parameters[0];
+}
+
+Type *Dictionary::value_type() const {
+    assert(m_parameters.size() == 2);
+    return m_parameters[1];
+}
+
+bool Dictionary::is_compatible(const Type *other) const {
+    auto other_dictionary = dynamic_cast<const Dictionary *>(other);
+    if (other_dictionary) {
+        return key_type()->is_compatible(other_dictionary->key_type()) &&
+            value_type()->is_compatible(other_dictionary->value_type());
+    } else {
+        return false;
+    }
+}
+
+Dictionary *Dictionary::with_parameters(std::vector<Type *> parameters) {
+    if (parameters.size() == 2) {
+        return new Dictionary(parameters[0], parameters[1]);
+    } else {
+        return nullptr;
+    }
+}
+
+void Dictionary::accept(Visitor *visitor) {
+    visitor->visit(this);
+}
+
+Record::Record(std::vector<std::string> field_names, std::vector<Type *> field_types, std::string declared_name) :
+        m_field_names(field_names),
+        m_declared_name(declared_name)
 {
     m_parameters = field_types;
 }
 
+std::string Record::declared_name() const {
+    return m_declared_name;
+}
+
 bool Record::has_field(std::string name) {
     for (auto &field_name : m_field_names) {
         if (field_name == name) {
@@ -935,7 +1157,7 @@ bool Record::is_compatible(const Type *other) const {
 }
 
 Record *Record::with_parameters(std::vector<Type *> parameters) {
-    return new Record(m_field_names, parameters);
+    return new Record(m_field_names, parameters, m_declared_name);
 }
 
 void Record::accept(Visitor *visitor) {
@@ -1101,7 +1323,7 @@ void Method::add_generic_specialisation(std::map<typesystem::ParameterType *, ty
     m_specialisations.push_back(specialisation);
 }
 
-std::vector<std::map<typesystem::ParameterType *, typesystem::Type *> > Method::generic_specialisations() {
+const std::vector<std::map<typesystem::ParameterType *, typesystem::Type *> > &Method::generic_specialisations() const {
     return m_specialisations;
 }
 
@@ -1235,3 +1457,42 @@ Function *Function::with_parameters(std::vector<Type *> parameters) {
 void Function::accept(Visitor *visitor) {
     visitor->visit(this);
 }
+
+// the loops count with an i64, so nothing narrower or wider will do
+static bool has_int_field(Record *record, std::string name) {
+    auto integer = dynamic_cast<Integer *>(record->get_field_type(name));
+    return integer != nullptr && integer->size() == 64;
+}
+
+bool typesystem::is_range(Type *type) {
+    auto record = dynamic_cast<Record *>(type);
+    return record != nullptr && record->declared_name() == "Range" &&
+           has_int_field(record, "start") && has_int_field(record, "stop");
+}
+
+bool typesystem::is_array(Type *type) {
+    auto record = dynamic_cast<Record *>(type);
+    return record != nullptr && record->declared_name() == "Array" &&
+           dynamic_cast<UnsafePointer *>(record->get_field_type("elements")) != nullptr &&
+           has_int_field(record, "length");
+}
+
+bool typesystem::is_array_iterator(Type *type) {
+    auto record = dynamic_cast<Record *>(type);
+    return record != nullptr && record->declared_name() == "ArrayIterator" &&
+           is_array(record->get_field_type("array")) && has_int_field(record, "state");
+}
+
+Type *typesystem::get_loop_element_type(Type *type) {
+    auto record = dynamic_cast<Record *>(type);
+
+    if (is_range(type)) {
+        return record->get_field_type("start");
+    } else if (is_array(type)) {
+        return static_cast<UnsafePointer *>(record->get_field_type("elements"))->element_type();
+    } else if (is_array_iterator(type)) {
+        return get_loop_element_type(record->get_field_type("array"));
+    } else {
+        return nullptr;
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*acorn_task_function)(void *frame);
+
+// the functions themselves are listed in acornrt.def, which the JIT also uses to find them
+
+#define ACORN_RUNTIME_FUNCTION(return_type, name, parameters, attributes) return_type name parameters attributes;
+#include "acornrt.def"
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,161 @@
+// Bounded multi-producer, multi-consumer channels.
+//
+// This is Dmitry Vyukov's bounded MPMC queue, the same one spdlog vendors as
+// mpmc_bounded_q.h. Every cell carries a sequence number that says whose turn it is: a
+// producer may claim the cell at position p when its sequence is p, a consumer when it is
+// p + 1. Claiming is one compare and swap on the shared position, and handing a cell
+// over is one release store to its sequence, so producers and consumers never take a lock
+// and only contend with their own kind.
+//
+// Generated code can't pass an arbitrary value by address, so the interface is split in
+// two: claim returns a pointer to the cell's element for the caller to write or read with
+// an ordinary store or load, and publish/release hands the cell on. A blocking claim
+// waits through the scheduler, which keeps a pipeline of spawned tasks moving even when
+// there are more stages blocked on each other than there are workers.
+//
+// Channels are allocated from the garbage collected heap with their cells inline, so
+// whatever is in flight stays reachable for as long as the channel is.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acornrt.h"
+
+namespace {
+
+    const size_t cache_line_size = 64;
+
+    struct Channel {
+        int64_t capacity;
+        int64_t cell_size;
+        char header_padding[cache_line_size - 2 * sizeof(int64_t)];
+
+        int64_t send_position;
+        char send_padding[cache_line_size - sizeof(int64_t)];
+
+        int64_t receive_position;
+        char receive_padding[cache_line_size - sizeof(int64_t)];
+    };
+
+    struct Cell {
+        int64_t sequence;
+    };
+
+    int64_t round_up(int64_t value, int64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    Cell *cell_at(Channel *channel, int64_t position) {
+        auto cells = reinterpret_cast<char *>(channel) + sizeof(Channel);
+        return reinterpret_cast<Cell *>(cells + (position & (channel->capacity - 1)) * channel->cell_size);
+    }
+
+    void *element_of(Cell *cell) {
+        return reinterpret_cast<char *>(cell) + sizeof(Cell);
+    }
+
+    Cell *cell_of(void *element) {
+        return reinterpret_cast<Cell *>(static_cast<char *>(element) - sizeof(Cell));
+    }
+
+    // claims the next cell at position whose sequence is position + offset, or null when the
+    // queue is full (offset 0) or empty (offset 1)
+    Cell *claim(Channel *channel, int64_t *position, int64_t offset) {
+        auto current = __atomic_load_n(position, __ATOMIC_RELAXED);
+
+        while (true) {
+            auto cell = cell_at(channel, current);
+            auto sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+            auto difference = sequence - (current + offset);
+
+            if (difference == 0) {
+                if (__atomic_compare_exchange_n(position, &current, current + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    return cell;
+                }
+            } else if (difference < 0) {
+                return nullptr;
+            } else {
+                // someone else claimed it first
+                current = __atomic_load_n(position, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+}
+
+extern "C" {
+
+void *acorn_channel_create(int64_t capacity, int64_t element_size) {
+    // a power of two, so positions can be masked rather than divided
+    int64_t rounded_capacity = 2;
+    while (rounded_capacity < capacity) {
+        rounded_capacity *= 2;
+    }
+
+    auto cell_size = round_up(sizeof(Cell) + element_size, sizeof(int64_t));
+
+    auto channel = static_cast<Channel *>(acorn_gc_allocate(sizeof(Channel) + rounded_capacity * cell_size));
+    if (channel == nullptr) {
+        return nullptr;
+    }
+
+    channel->capacity = rounded_capacity;
+    channel->cell_size = cell_size;
+
+    for (int64_t i = 0; i < rounded_capacity; i++) {
+        cell_at(channel, i)->sequence = i;
+    }
+
+    return channel;
+}
+
+void *acorn_channel_claim_send(void *handle, int64_t blocking) {
+    auto channel = static_cast<Channel *>(handle);
+
+    for (int64_t waits = 0; ; waits++) {
+        if (auto cell = claim(channel, &channel->send_position, 0)) {
+            return element_of(cell);
+        } else if (!blocking) {
+            return nullptr;
+        }
+
+        acorn_task_wait(waits);
+    }
+}
+
+void acorn_channel_publish(void *handle, void *element) {
+    auto cell = cell_of(element);
+
+    // the cell's sequence is still the position it was claimed at
+    auto sequence = __atomic_load_n(&cell->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&cell->sequence, sequence + 1, __ATOMIC_RELEASE);
+}
+
+void *acorn_channel_claim_receive(void *handle, int64_t blocking) {
+    auto channel = static_cast<Channel *>(handle);
+
+    for (int64_t waits = 0; ; waits++) {
+        if (auto cell = claim(channel, &channel->receive_position, 1)) {
+            return element_of(cell);
+        } else if (!blocking) {
+            return nullptr;
+        }
+
+        acorn_task_wait(waits);
+    }
+}
+
+void acorn_channel_release(void *handle, void *element) {
+    auto channel = static_cast<Channel *>(handle);
+    auto cell = cell_of(element);
+
+    // hand the cell back to producers a lap later, at position + capacity
+    auto sequence = __atomic_load_n(&cell->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&cell->sequence, sequence - 1 + channel->capacity, __ATOMIC_RELEASE);
+}
+
+int64_t acorn_channel_capacity(void *handle) {
+    return static_cast<Channel *>(handle)->capacity;
+}
+
+}
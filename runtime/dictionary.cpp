@@ -0,0 +1,427 @@
+// Hash tables for Dictionary{K, V}.
+//
+// This is an open addressing table laid out like Abseil's SwissTable. Alongside the slots
+// there is one control byte per slot: 0x80 when it's empty, 0xFE when it held a key that
+// has since been removed, and otherwise the bottom seven bits of the key's hash. A lookup
+// loads a whole group of control bytes at once and compares all of them against those
+// seven bits in a couple of instructions, so it only touches a slot when the key in it is
+// very likely to be the one it wants. Groups are probed in triangular order, which visits
+// every group exactly once because the number of groups is a power of two, and a probe
+// stops at the first group with an empty slot in it.
+//
+// With SSE2 a group is 16 bytes compared with one pcmpeqb. Without it a group is 8 bytes
+// compared as a single word, which gives the odd false positive for a full slot; that
+// only costs a key comparison, since a match is always checked against the key itself.
+//
+// The table grows once seven eighths of its slots are full or removed. Generated code
+// can't pass a key or value by address, so keys are copied in by the caller and inserting
+// hands back a pointer to the value's slot for it to store into, like channels do.
+//
+// Keys are compared as plain bytes, except for strings, which are compared by what they
+// point at. Tables live on the garbage collected heap with their control bytes and slots
+// in one allocation, so anything stored in them is reachable for as long as they are.
+// They aren't safe to share between tasks without some other synchronisation.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "acornrt.h"
+
+namespace {
+
+    const uint8_t control_empty = 0x80;
+    const uint8_t control_deleted = 0xFE;
+
+    const int64_t minimum_capacity = 16;
+
+    const int64_t key_kind_bytes = 0;
+    const int64_t key_kind_string = 1;
+
+    struct Table {
+        int64_t length;
+        int64_t capacity;
+        int64_t growth_left;
+
+        int64_t key_size;
+        int64_t value_size;
+        int64_t value_offset;
+        int64_t slot_size;
+        int64_t key_kind;
+
+        // capacity control bytes followed by capacity slots
+        uint8_t *controls;
+    };
+
+    struct String {
+        const char *bytes;
+        int64_t length;
+    };
+
+    // the positions in a group that matched, lowest first
+    struct Mask {
+        uint64_t bits;
+        int shift;
+
+        bool any() const {
+            return bits != 0;
+        }
+
+        int lowest() const {
+            return __builtin_ctzll(bits) >> shift;
+        }
+
+        void clear_lowest() {
+            bits &= bits - 1;
+        }
+    };
+
+#ifdef __SSE2__
+
+    const int64_t group_width = 16;
+
+    struct Group {
+        __m128i controls;
+
+        explicit Group(const uint8_t *position) {
+            controls = _mm_loadu_si128(reinterpret_cast<const __m128i *>(position));
+        }
+
+        Mask match(uint8_t hash) const {
+            auto matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(hash)), controls);
+            return { static_cast<uint64_t>(_mm_movemask_epi8(matches)), 0 };
+        }
+
+        Mask match_empty() const {
+            auto matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(control_empty)), controls);
+            return { static_cast<uint64_t>(_mm_movemask_epi8(matches)), 0 };
+        }
+
+        // empty and deleted are the only control bytes with the top bit set
+        Mask match_empty_or_deleted() const {
+            return { static_cast<uint64_t>(_mm_movemask_epi8(controls)), 0 };
+        }
+    };
+
+#else
+
+    const int64_t group_width = 8;
+
+    const uint64_t low_bits = 0x0101010101010101;
+    const uint64_t high_bits = 0x8080808080808080;
+
+    struct Group {
+        uint64_t controls;
+
+        explicit Group(const uint8_t *position) {
+            memcpy(&controls, position, sizeof(controls));
+        }
+
+        // a byte is zero where the hash matches, found with the usual has-zero-byte trick
+        Mask match(uint8_t hash) const {
+            auto difference = controls ^ (low_bits * hash);
+            return { (difference - low_bits) & ~difference & high_bits, 3 };
+        }
+
+        // empty has the top bit set and the second bit clear, deleted has both set
+        Mask match_empty() const {
+            return { controls & ~(controls << 6) & high_bits, 3 };
+        }
+
+        Mask match_empty_or_deleted() const {
+            return { controls & high_bits, 3 };
+        }
+    };
+
+#endif
+
+    uint64_t hash_bytes(const void *data, int64_t size) {
+        auto bytes = static_cast<const uint8_t *>(data);
+
+        uint64_t hash = 0x9E3779B97F4A7C15 ^ static_cast<uint64_t>(size);
+        while (size >= 8) {
+            uint64_t word;
+            memcpy(&word, bytes, sizeof(word));
+            hash = (hash ^ word) * 0xBF58476D1CE4E5B9;
+            hash ^= hash >> 31;
+            bytes += 8;
+            size -= 8;
+        }
+
+        if (size > 0) {
+            uint64_t word = 0;
+            memcpy(&word, bytes, size);
+            hash = (hash ^ word) * 0xBF58476D1CE4E5B9;
+            hash ^= hash >> 31;
+        }
+
+        // the bottom seven bits go in the control byte, so make sure every bit reaches them
+        hash *= 0x94D049BB133111EB;
+        return hash ^ (hash >> 29);
+    }
+
+    uint64_t hash_key(Table *table, const void *key) {
+        if (table->key_kind == key_kind_string) {
+            auto string = static_cast<const String *>(key);
+            return hash_bytes(string->bytes, string->length);
+        } else {
+            return hash_bytes(key, table->key_size);
+        }
+    }
+
+    bool keys_equal(Table *table, const void *left, const void *right) {
+        if (table->key_kind == key_kind_string) {
+            auto left_string = static_cast<const String *>(left);
+            auto right_string = static_cast<const String *>(right);
+            return left_string->length == right_string->length &&
+                memcmp(left_string->bytes, right_string->bytes, left_string->length) == 0;
+        } else {
+            return memcmp(left, right, table->key_size) == 0;
+        }
+    }
+
+    uint8_t *slot_at(Table *table, int64_t index) {
+        return table->controls + table->capacity + index * table->slot_size;
+    }
+
+    int64_t round_up(int64_t value, int64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    int64_t maximum_load(int64_t capacity) {
+        return capacity - capacity / 8;
+    }
+
+    // the smallest capacity that holds length keys without growing
+    int64_t capacity_for(int64_t length) {
+        int64_t capacity = minimum_capacity;
+        while (maximum_load(capacity) < length) {
+            capacity *= 2;
+        }
+
+        return capacity;
+    }
+
+    bool allocate_slots(Table *table, int64_t capacity) {
+        auto controls = static_cast<uint8_t *>(acorn_gc_allocate(capacity + capacity * table->slot_size));
+        if (controls == nullptr) {
+            return false;
+        }
+
+        memset(controls, control_empty, capacity);
+
+        table->controls = controls;
+        table->capacity = capacity;
+        table->growth_left = maximum_load(capacity) - table->length;
+        return true;
+    }
+
+    // walks the groups a hash can be in, in the order every probe for it visits them
+    struct Probe {
+        int64_t mask;
+        int64_t offset;
+        int64_t index;
+
+        Probe(Table *table, uint64_t hash) {
+            mask = table->capacity / group_width - 1;
+            offset = static_cast<int64_t>(hash >> 7) & mask;
+            index = 0;
+        }
+
+        int64_t group() const {
+            return offset * group_width;
+        }
+
+        void next() {
+            index++;
+            offset = (offset + index) & mask;
+        }
+    };
+
+    int64_t find_index(Table *table, const void *key, uint64_t hash) {
+        auto control = static_cast<uint8_t>(hash & 0x7F);
+
+        for (Probe probe(table, hash); ; probe.next()) {
+            Group group(table->controls + probe.group());
+
+            for (auto matches = group.match(control); matches.any(); matches.clear_lowest()) {
+                auto index = probe.group() + matches.lowest();
+                if (keys_equal(table, slot_at(table, index), key)) {
+                    return index;
+                }
+            }
+
+            if (group.match_empty().any()) {
+                return -1;
+            }
+        }
+    }
+
+    // the first empty or deleted slot on the probe sequence, where a new key with this hash goes
+    int64_t find_free_index(Table *table, uint64_t hash) {
+        for (Probe probe(table, hash); ; probe.next()) {
+            auto frees = Group(table->controls + probe.group()).match_empty_or_deleted();
+            if (frees.any()) {
+                return probe.group() + frees.lowest();
+            }
+        }
+    }
+
+    bool resize(Table *table, int64_t capacity) {
+        auto old_controls = table->controls;
+        auto old_capacity = table->capacity;
+        auto old_slots = old_controls + old_capacity;
+
+        if (!allocate_slots(table, capacity)) {
+            return false;
+        }
+
+        for (int64_t i = 0; i < old_capacity; i++) {
+            if (old_controls[i] & 0x80) {
+                continue;
+            }
+
+            auto slot = old_slots + i * table->slot_size;
+            auto hash = hash_key(table, slot);
+
+            auto index = find_free_index(table, hash);
+            table->controls[index] = static_cast<uint8_t>(hash & 0x7F);
+            memcpy(slot_at(table, index), slot, table->slot_size);
+        }
+
+        return true;
+    }
+
+    void *insert(Table *table, const void *key) {
+        auto hash = hash_key(table, key);
+
+        auto found = find_index(table, key, hash);
+        if (found >= 0) {
+            return slot_at(table, found) + table->value_offset;
+        }
+
+        auto index = find_free_index(table, hash);
+        if (table->growth_left == 0 && table->controls[index] != control_deleted) {
+            // mostly tombstones means a rehash at the same size is enough to make room
+            auto capacity = table->length + 1 > maximum_load(table->capacity) / 2 ?
+                table->capacity * 2 : table->capacity;
+
+            if (!resize(table, capacity)) {
+                return nullptr;
+            }
+
+            index = find_free_index(table, hash);
+        }
+
+        if (table->controls[index] == control_empty) {
+            table->growth_left--;
+        }
+
+        table->controls[index] = static_cast<uint8_t>(hash & 0x7F);
+        table->length++;
+
+        auto slot = slot_at(table, index);
+        memcpy(slot, key, table->key_size);
+        memset(slot + table->value_offset, 0, table->value_size);
+
+        return slot + table->value_offset;
+    }
+
+}
+
+extern "C" {
+
+void *acorn_dictionary_create(int64_t capacity, int64_t key_size, int64_t value_size, int64_t key_kind) {
+    auto table = static_cast<Table *>(acorn_gc_allocate(sizeof(Table)));
+    if (table == nullptr) {
+        return nullptr;
+    }
+
+    table->key_size = key_size;
+    table->value_size = value_size;
+    table->value_offset = round_up(key_size, 8);
+    table->slot_size = table->value_offset + round_up(value_size, 8);
+    table->key_kind = key_kind;
+
+    if (!allocate_slots(table, capacity_for(capacity))) {
+        return nullptr;
+    }
+
+    return table;
+}
+
+void *acorn_dictionary_create_from(int64_t count, int64_t key_size, int64_t value_size, int64_t key_kind,
+                                   const void *keys, const void *values) {
+    // sized up front, so building it never has to grow
+    auto table = static_cast<Table *>(acorn_dictionary_create(count, key_size, value_size, key_kind));
+    if (table == nullptr) {
+        return nullptr;
+    }
+
+    auto key_bytes = static_cast<const uint8_t *>(keys);
+    auto value_bytes = static_cast<const uint8_t *>(values);
+
+    // a repeated key takes the last value it was given
+    for (int64_t i = 0; i < count; i++) {
+        auto value = insert(table, key_bytes + i * key_size);
+        memcpy(value, value_bytes + i * value_size, value_size);
+    }
+
+    return table;
+}
+
+int64_t acorn_dictionary_length(void *handle) {
+    return static_cast<Table *>(handle)->length;
+}
+
+void *acorn_dictionary_find(void *handle, const void *key) {
+    auto table = static_cast<Table *>(handle);
+
+    auto index = find_index(table, key, hash_key(table, key));
+    if (index < 0) {
+        return nullptr;
+    }
+
+    return slot_at(table, index) + table->value_offset;
+}
+
+void *acorn_dictionary_lookup(void *handle, const void *key) {
+    auto value = acorn_dictionary_find(handle, key);
+    if (value == nullptr) {
+        acorn_key_error();
+    }
+
+    return value;
+}
+
+void *acorn_dictionary_insert(void *handle, const void *key) {
+    return insert(static_cast<Table *>(handle), key);
+}
+
+int64_t acorn_dictionary_remove(void *handle, const void *key) {
+    auto table = static_cast<Table *>(handle);
+
+    auto index = find_index(table, key, hash_key(table, key));
+    if (index < 0) {
+        return 0;
+    }
+
+    // a probe only carries on past a group with no empty slot, so if this one still has one
+    // then nothing was ever probed through here and the slot can go straight back to empty
+    auto group = index & ~(group_width - 1);
+    if (Group(table->controls + group).match_empty().any()) {
+        table->controls[index] = control_empty;
+        table->growth_left++;
+    } else {
+        table->controls[index] = control_deleted;
+    }
+
+    table->length--;
+    return 1;
+}
+
+}
@@ -0,0 +1,22 @@
+// Errors raised by generated code. These are on the cold path of every check that can fail,
+// so they take plain integers and do all of the formatting here.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "acornrt.h"
+
+extern "C" {
+
+void acorn_bounds_error(int64_t index, int64_t length) {
+    fprintf(stderr, "index %" PRId64 " is out of bounds for an array of length %" PRId64 "\n", index, length);
+    abort();
+}
+
+void acorn_key_error(void) {
+    fprintf(stderr, "key is not in the dictionary\n");
+    abort();
+}
+
+}
@@ -0,0 +1,806 @@
+// A conservative, non-moving mark-sweep collector.
+//
+// Small objects are bump allocated out of thread local allocation buffers (TLABs) carved
+// from 1MB chunks, large ones get pages of their own. Every small object has a one word
+// header holding its size and a bit in its chunk's start bitmap, which is what lets the
+// collector map an arbitrary word back to the object it points into. Roots are the stacks
+// and registers of every registered thread, plus ranges registered by generated code for
+// global variables. Collection stops the world with a signal, marks from the roots, then
+// sweeps the gaps between live objects into holes that become TLABs again.
+//
+// This is linked into every program, so it sticks to libc and pthreads: no exceptions,
+// no RTTI, no operator new, and nothing that mallocs while the world is stopped, since a
+// stopped thread may be holding malloc's lock.
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "acornrt.h"
+
+namespace {
+
+    const size_t granule_size = 8;
+    const size_t header_size = 8;
+
+    const size_t chunk_size = 1 << 20;
+    const size_t granules_per_chunk = chunk_size / granule_size;
+    const size_t bitmap_words = granules_per_chunk / 64;
+
+    const size_t tlab_size = 32 << 10;
+    const size_t large_object_size = 8 << 10;
+
+    // TLABs start and end on a bitmap word boundary, so two threads never share a word
+    const size_t hole_alignment = 64 * granule_size;
+    const size_t minimum_hole_size = hole_alignment;
+
+    const size_t minimum_collection_threshold = 4 << 20;
+
+    const int suspend_signal = SIGXCPU;
+
+    struct Chunk {
+        uint64_t starts[bitmap_words];
+        uint64_t marks[bitmap_words];
+    };
+
+    const size_t chunk_header_size = (sizeof(Chunk) + hole_alignment - 1) & ~(hole_alignment - 1);
+
+    struct LargeObject {
+        size_t size;
+        uint64_t marked;
+    };
+
+    struct Hole {
+        size_t size;
+        Hole *next;
+    };
+
+    struct Range {
+        char *start;
+        char *end;
+    };
+
+    struct ThreadRecord {
+        pthread_t thread;
+        char *stack_top;
+        char *volatile stack_pointer;
+
+        char *cursor;
+        char *limit;
+
+        ThreadRecord *next;
+    };
+
+    void *map_pages(size_t size) {
+        void *pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return pages == MAP_FAILED ? nullptr : pages;
+    }
+
+    void unmap_pages(void *pages, size_t size) {
+        munmap(pages, size);
+    }
+
+    size_t round_up(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // a growable array that gets its memory straight from mmap, zero initialised so it can be a global
+    template <typename T>
+    struct Array {
+        T *data;
+        size_t size;
+        size_t capacity;
+
+        bool reserve(size_t new_capacity) {
+            if (new_capacity <= capacity) {
+                return true;
+            }
+
+            new_capacity = round_up(new_capacity * sizeof(T), 4096) / sizeof(T);
+            auto new_data = static_cast<T *>(map_pages(new_capacity * sizeof(T)));
+            if (new_data == nullptr) {
+                return false;
+            }
+
+            if (data != nullptr) {
+                memcpy(new_data, data, size * sizeof(T));
+                unmap_pages(data, round_up(capacity * sizeof(T), 4096));
+            }
+
+            data = new_data;
+            capacity = new_capacity;
+            return true;
+        }
+
+        bool insert(size_t index, T value) {
+            if (size == capacity && !reserve(capacity == 0 ? 64 : capacity * 2)) {
+                return false;
+            }
+
+            memmove(data + index + 1, data + index, (size - index) * sizeof(T));
+            data[index] = value;
+            size++;
+            return true;
+        }
+
+        bool push(T value) {
+            return insert(size, value);
+        }
+
+        bool insert_sorted(T value) {
+            auto index = find_floor(value);
+            return insert(index == size ? 0 : index + 1, value);
+        }
+
+        void remove(size_t index) {
+            memmove(data + index, data + index + 1, (size - index - 1) * sizeof(T));
+            size--;
+        }
+
+        // the index of the last element <= value, or size if there isn't one
+        size_t find_floor(T value) const {
+            size_t low = 0;
+            size_t high = size;
+            while (low < high) {
+                size_t middle = (low + high) / 2;
+                if (data[middle] <= value) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+
+            return low == 0 ? size : low - 1;
+        }
+    };
+
+    pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+    bool initialised;
+
+    Array<Chunk *> chunks;
+    Array<LargeObject *> large_objects;
+    Array<Range> roots;
+    Array<Range> mark_stack;
+
+    // set when the mark stack couldn't grow, so some marked objects haven't been scanned
+    bool mark_stack_overflowed;
+
+    Hole *holes;
+    char *fresh_cursor;
+    char *fresh_limit;
+
+    ThreadRecord *threads;
+    thread_local ThreadRecord *current_thread;
+
+    size_t bytes_since_collection;
+    size_t collection_threshold = minimum_collection_threshold;
+    size_t live_bytes;
+    size_t large_object_bytes;
+
+    volatile int suspended_count;
+    volatile int world_stopped;
+
+    Chunk *chunk_of(const char *pointer) {
+        return reinterpret_cast<Chunk *>(reinterpret_cast<uintptr_t>(pointer) & ~(chunk_size - 1));
+    }
+
+    size_t granule_of(const char *pointer) {
+        return (reinterpret_cast<uintptr_t>(pointer) & (chunk_size - 1)) / granule_size;
+    }
+
+    bool test_bit(const uint64_t *bitmap, size_t index) {
+        return (bitmap[index / 64] >> (index % 64)) & 1;
+    }
+
+    void set_bit(uint64_t *bitmap, size_t index) {
+        bitmap[index / 64] |= uint64_t(1) << (index % 64);
+    }
+
+    void clear_bit(uint64_t *bitmap, size_t index) {
+        bitmap[index / 64] &= ~(uint64_t(1) << (index % 64));
+    }
+
+    // the next set bit at or after index, or granules_per_chunk
+    size_t find_next_bit(const uint64_t *bitmap, size_t index) {
+        while (index < granules_per_chunk) {
+            auto word = bitmap[index / 64] >> (index % 64);
+            if (word != 0) {
+                return index + __builtin_ctzll(word);
+            }
+
+            index = (index / 64 + 1) * 64;
+        }
+
+        return granules_per_chunk;
+    }
+
+    char *get_stack_top() {
+#ifdef __APPLE__
+        return static_cast<char *>(pthread_get_stackaddr_np(pthread_self()));
+#else
+        pthread_attr_t attributes;
+        pthread_getattr_np(pthread_self(), &attributes);
+
+        void *address;
+        size_t size;
+        pthread_attr_getstack(&attributes, &address, &size);
+        pthread_attr_destroy(&attributes);
+
+        return static_cast<char *>(address) + size;
+#endif
+    }
+
+    void suspend_handler(int) {
+        int saved_errno = errno;
+
+        // spill the callee saved registers, everything else is in the signal frame above us
+        jmp_buf registers;
+        setjmp(registers);
+
+        current_thread->stack_pointer = reinterpret_cast<char *>(&registers);
+        __atomic_add_fetch(&suspended_count, 1, __ATOMIC_SEQ_CST);
+
+        while (__atomic_load_n(&world_stopped, __ATOMIC_SEQ_CST)) {
+            sched_yield();
+        }
+
+        __atomic_sub_fetch(&suspended_count, 1, __ATOMIC_SEQ_CST);
+
+        errno = saved_errno;
+    }
+
+    void stop_world() {
+        __atomic_store_n(&world_stopped, 1, __ATOMIC_SEQ_CST);
+
+        int expected = 0;
+        for (auto thread = threads; thread != nullptr; thread = thread->next) {
+            if (thread != current_thread) {
+                pthread_kill(thread->thread, suspend_signal);
+                expected++;
+            }
+        }
+
+        while (__atomic_load_n(&suspended_count, __ATOMIC_SEQ_CST) < expected) {
+            sched_yield();
+        }
+    }
+
+    void start_world() {
+        __atomic_store_n(&world_stopped, 0, __ATOMIC_SEQ_CST);
+
+        while (__atomic_load_n(&suspended_count, __ATOMIC_SEQ_CST) > 0) {
+            sched_yield();
+        }
+    }
+
+    Chunk *find_chunk(const char *pointer) {
+        auto chunk = chunk_of(pointer);
+        auto index = chunks.find_floor(chunk);
+        if (index == chunks.size || chunks.data[index] != chunk) {
+            return nullptr;
+        }
+
+        return chunk;
+    }
+
+    void push_mark_stack(char *start, char *end) {
+        if (!mark_stack.push({ start, end })) {
+            mark_stack_overflowed = true;
+        }
+    }
+
+    void mark_pointer(char *pointer) {
+        if (auto chunk = find_chunk(pointer)) {
+            auto granule = granule_of(pointer);
+            if (granule < chunk_header_size / granule_size) {
+                return;
+            }
+
+            // walk back to the start of the object, which can't be further than the largest small object
+            auto first_granule = chunk_header_size / granule_size;
+            auto limit = granule >= first_granule + large_object_size / granule_size ?
+                granule - large_object_size / granule_size : first_granule;
+            while (!test_bit(chunk->starts, granule)) {
+                if (granule == limit) {
+                    return;
+                }
+                granule--;
+            }
+
+            auto start = reinterpret_cast<char *>(chunk) + granule * granule_size;
+            auto size = *reinterpret_cast<size_t *>(start);
+            if (pointer >= start + size || test_bit(chunk->marks, granule)) {
+                return;
+            }
+
+            set_bit(chunk->marks, granule);
+            push_mark_stack(start + header_size, start + size);
+            return;
+        }
+
+        auto index = large_objects.find_floor(reinterpret_cast<LargeObject *>(pointer));
+        if (index == large_objects.size) {
+            return;
+        }
+
+        auto object = large_objects.data[index];
+        auto start = reinterpret_cast<char *>(object);
+        if (pointer >= start + sizeof(LargeObject) + object->size || object->marked) {
+            return;
+        }
+
+        object->marked = 1;
+        push_mark_stack(start + sizeof(LargeObject), start + sizeof(LargeObject) + object->size);
+    }
+
+    void mark_range(char *start, char *end) {
+        auto word = reinterpret_cast<char **>(round_up(reinterpret_cast<uintptr_t>(start), sizeof(char *)));
+        for (; reinterpret_cast<char *>(word + 1) <= end; word++) {
+            mark_pointer(*word);
+        }
+    }
+
+    // scanning everything that's marked again finds whatever a dropped mark stack entry would have
+    void rescan_marked_objects() {
+        for (size_t i = 0; i < chunks.size; i++) {
+            auto chunk = chunks.data[i];
+            auto base = reinterpret_cast<char *>(chunk);
+
+            for (auto granule = find_next_bit(chunk->marks, 0); granule < granules_per_chunk;
+                 granule = find_next_bit(chunk->marks, granule + 1)) {
+                auto start = base + granule * granule_size;
+                mark_range(start + header_size, start + *reinterpret_cast<size_t *>(start));
+            }
+        }
+
+        for (size_t i = 0; i < large_objects.size; i++) {
+            auto object = large_objects.data[i];
+            if (object->marked) {
+                auto start = reinterpret_cast<char *>(object) + sizeof(LargeObject);
+                mark_range(start, start + object->size);
+            }
+        }
+    }
+
+    void drain_mark_stack() {
+        while (true) {
+            while (mark_stack.size > 0) {
+                auto range = mark_stack.data[--mark_stack.size];
+                mark_range(range.start, range.end);
+            }
+
+            if (!mark_stack_overflowed) {
+                return;
+            }
+
+            mark_stack_overflowed = false;
+            rescan_marked_objects();
+        }
+    }
+
+    void add_hole(char *start, char *end) {
+        start = reinterpret_cast<char *>(round_up(reinterpret_cast<uintptr_t>(start), hole_alignment));
+        end = reinterpret_cast<char *>(reinterpret_cast<uintptr_t>(end) & ~(hole_alignment - 1));
+        if (end <= start || static_cast<size_t>(end - start) < minimum_hole_size) {
+            return;
+        }
+
+        auto hole = reinterpret_cast<Hole *>(start);
+        hole->size = end - start;
+        hole->next = holes;
+        holes = hole;
+    }
+
+    // the part of a thread's TLAB it hasn't used yet, which the sweep has to leave alone
+    bool find_reserved(char *start, char *end, char *&reserved_start, char *&reserved_end) {
+        reserved_start = end;
+        reserved_end = end;
+
+        for (auto thread = threads; thread != nullptr; thread = thread->next) {
+            if (thread->cursor == thread->limit) {
+                continue;
+            }
+
+            if (thread->cursor >= start && thread->cursor < end && thread->cursor < reserved_start) {
+                reserved_start = thread->cursor;
+                reserved_end = thread->limit;
+            }
+        }
+
+        return reserved_start != end;
+    }
+
+    bool sweep_chunk(Chunk *chunk) {
+        auto base = reinterpret_cast<char *>(chunk);
+        auto first_granule = chunk_header_size / granule_size;
+        bool has_live_objects = false;
+
+        auto position = base + chunk_header_size;
+        auto granule = find_next_bit(chunk->starts, first_granule);
+
+        while (position < base + chunk_size) {
+            char *reserved_start, *reserved_end;
+            find_reserved(position, base + chunk_size, reserved_start, reserved_end);
+
+            // objects inside a reserved TLAB may still be being published, so they're all kept
+            auto object = base + granule * granule_size;
+            while (granule < granules_per_chunk && object < reserved_start && !test_bit(chunk->marks, granule)) {
+                clear_bit(chunk->starts, granule);
+                granule = find_next_bit(chunk->starts, granule + 1);
+                object = base + granule * granule_size;
+            }
+
+            if (granule < granules_per_chunk && object < reserved_start) {
+                auto size = *reinterpret_cast<size_t *>(object);
+                add_hole(position, object);
+                position = object + size;
+                live_bytes += size;
+                has_live_objects = true;
+                granule = find_next_bit(chunk->starts, granule + size / granule_size);
+            } else if (reserved_start < base + chunk_size) {
+                add_hole(position, reserved_start);
+                position = reserved_end;
+                has_live_objects = true;
+                granule = find_next_bit(chunk->starts, granule_of(reserved_end - 1) + 1);
+            } else {
+                add_hole(position, base + chunk_size);
+                position = base + chunk_size;
+            }
+        }
+
+        memset(chunk->marks, 0, sizeof(chunk->marks));
+
+        return has_live_objects;
+    }
+
+    void sweep() {
+        holes = nullptr;
+        fresh_cursor = nullptr;
+        fresh_limit = nullptr;
+        live_bytes = 0;
+
+        for (size_t i = 0; i < chunks.size;) {
+            auto chunk = chunks.data[i];
+
+            auto hole_list = holes;
+            if (sweep_chunk(chunk)) {
+                i++;
+                continue;
+            }
+
+            // nothing lives here, so give the whole chunk back rather than keeping it as holes
+            holes = hole_list;
+            chunks.remove(i);
+            unmap_pages(chunk, chunk_size);
+        }
+
+        for (size_t i = 0; i < large_objects.size;) {
+            auto object = large_objects.data[i];
+            if (object->marked) {
+                object->marked = 0;
+                live_bytes += object->size;
+                i++;
+                continue;
+            }
+
+            large_objects.remove(i);
+            large_object_bytes -= object->size;
+            unmap_pages(object, round_up(sizeof(LargeObject) + object->size, 4096));
+        }
+    }
+
+    void collect() {
+        stop_world();
+
+        // get our own callee saved registers onto the stack so they're scanned with it
+        __builtin_unwind_init();
+        jmp_buf registers;
+        setjmp(registers);
+
+        if (current_thread != nullptr) {
+            mark_range(reinterpret_cast<char *>(&registers), current_thread->stack_top);
+        }
+
+        for (auto thread = threads; thread != nullptr; thread = thread->next) {
+            if (thread != current_thread) {
+                mark_range(thread->stack_pointer, thread->stack_top);
+            }
+        }
+
+        drain_mark_stack();
+
+        for (size_t i = 0; i < roots.size; i++) {
+            mark_range(roots.data[i].start, roots.data[i].end);
+            drain_mark_stack();
+        }
+
+        sweep();
+
+        bytes_since_collection = 0;
+        collection_threshold = live_bytes > minimum_collection_threshold ? live_bytes : minimum_collection_threshold;
+
+        start_world();
+    }
+
+    bool add_chunk() {
+        // over allocate so the chunk can be aligned to its own size, then trim
+        auto pages = static_cast<char *>(map_pages(chunk_size * 2));
+        if (pages == nullptr) {
+            return false;
+        }
+
+        auto chunk = reinterpret_cast<char *>(round_up(reinterpret_cast<uintptr_t>(pages), chunk_size));
+        if (chunk > pages) {
+            unmap_pages(pages, chunk - pages);
+        }
+        unmap_pages(chunk + chunk_size, pages + chunk_size * 2 - (chunk + chunk_size));
+
+        if (!chunks.insert_sorted(reinterpret_cast<Chunk *>(chunk))) {
+            unmap_pages(chunk, chunk_size);
+            return false;
+        }
+
+        fresh_cursor = chunk + chunk_header_size;
+        fresh_limit = chunk + chunk_size;
+        return true;
+    }
+
+    bool refill_tlab(ThreadRecord *thread, size_t size) {
+        Hole **previous = &holes;
+        for (auto hole = holes; hole != nullptr; previous = &hole->next, hole = hole->next) {
+            if (hole->size < size) {
+                continue;
+            }
+
+            auto start = reinterpret_cast<char *>(hole);
+            auto hole_size = hole->size;
+            auto next = hole->next;
+            auto taken = hole_size - size < minimum_hole_size || hole_size <= tlab_size ?
+                hole_size : round_up(size > tlab_size ? size : tlab_size, hole_alignment);
+
+            if (hole_size - taken >= minimum_hole_size) {
+                auto remainder = reinterpret_cast<Hole *>(start + taken);
+                remainder->size = hole_size - taken;
+                remainder->next = next;
+                *previous = remainder;
+            } else {
+                *previous = next;
+            }
+
+            // holes are full of dead objects, which the program expects to be zero
+            memset(start, 0, taken);
+
+            thread->cursor = start;
+            thread->limit = start + taken;
+            bytes_since_collection += taken;
+            return true;
+        }
+
+        if (static_cast<size_t>(fresh_limit - fresh_cursor) < size && !add_chunk()) {
+            return false;
+        }
+
+        // fresh chunks come from mmap, so they're already zero
+        auto taken = static_cast<size_t>(fresh_limit - fresh_cursor) < tlab_size ?
+            static_cast<size_t>(fresh_limit - fresh_cursor) : tlab_size;
+
+        thread->cursor = fresh_cursor;
+        thread->limit = fresh_cursor + taken;
+        fresh_cursor += taken;
+        bytes_since_collection += taken;
+        return true;
+    }
+
+    void *allocate_large(size_t size) {
+        auto total = round_up(sizeof(LargeObject) + size, 4096);
+        auto object = static_cast<LargeObject *>(map_pages(total));
+        if (object == nullptr) {
+            return nullptr;
+        }
+
+        object->size = size;
+        object->marked = 0;
+
+        if (!large_objects.insert_sorted(object)) {
+            unmap_pages(object, total);
+            return nullptr;
+        }
+
+        large_object_bytes += size;
+        bytes_since_collection += size;
+
+        return reinterpret_cast<char *>(object) + sizeof(LargeObject);
+    }
+
+    void register_thread() {
+        if (current_thread != nullptr) {
+            return;
+        }
+
+        auto thread = static_cast<ThreadRecord *>(map_pages(sizeof(ThreadRecord)));
+        thread->thread = pthread_self();
+        thread->stack_top = get_stack_top();
+        thread->stack_pointer = nullptr;
+        thread->cursor = nullptr;
+        thread->limit = nullptr;
+
+        thread->next = threads;
+        threads = thread;
+        current_thread = thread;
+    }
+
+    // a child process only has the thread that forked, so the heap lock is held across the
+    // fork to keep the heap consistent, and the child forgets every other thread it knew of;
+    // otherwise its first collection would wait forever for threads that aren't there
+    void lock_before_fork() {
+        pthread_mutex_lock(&heap_lock);
+    }
+
+    void unlock_after_fork() {
+        pthread_mutex_unlock(&heap_lock);
+    }
+
+    void forget_other_threads() {
+        for (auto thread = threads; thread != nullptr;) {
+            auto next = thread->next;
+            if (thread != current_thread) {
+                unmap_pages(thread, sizeof(ThreadRecord));
+            }
+            thread = next;
+        }
+
+        threads = current_thread;
+        if (current_thread != nullptr) {
+            current_thread->next = nullptr;
+        }
+
+        suspended_count = 0;
+        world_stopped = 0;
+
+        pthread_mutex_unlock(&heap_lock);
+    }
+
+    void initialise() {
+        if (initialised) {
+            return;
+        }
+
+        pthread_atfork(lock_before_fork, unlock_after_fork, forget_other_threads);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = suspend_handler;
+        action.sa_flags = SA_RESTART;
+        sigfillset(&action.sa_mask);
+        sigaction(suspend_signal, &action, nullptr);
+
+        initialised = true;
+    }
+
+    void *allocate_slow(size_t size) {
+        pthread_mutex_lock(&heap_lock);
+
+        initialise();
+        register_thread();
+
+        if (bytes_since_collection >= collection_threshold) {
+            collect();
+        }
+
+        void *result = nullptr;
+        if (size > large_object_size) {
+            result = allocate_large(size - header_size);
+        } else if (refill_tlab(current_thread, size)) {
+            auto cursor = current_thread->cursor;
+            *reinterpret_cast<size_t *>(cursor) = size;
+            set_bit(chunk_of(cursor)->starts, granule_of(cursor));
+            current_thread->cursor = cursor + size;
+            result = cursor + header_size;
+        }
+
+        pthread_mutex_unlock(&heap_lock);
+
+        return result;
+    }
+
+}
+
+extern "C" {
+
+void acorn_gc_initialise(void) {
+    pthread_mutex_lock(&heap_lock);
+    initialise();
+    register_thread();
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void *acorn_gc_allocate(int64_t size) {
+    auto total = round_up(static_cast<size_t>(size) + header_size, granule_size);
+
+    auto thread = current_thread;
+    if (thread != nullptr && total <= static_cast<size_t>(thread->limit - thread->cursor)) {
+        // the start bit has to be set before the cursor moves, see find_reserved, and since
+        // a collection can stop this thread between any two stores the compiler mustn't swap them
+        auto cursor = thread->cursor;
+        *reinterpret_cast<size_t *>(cursor) = total;
+        set_bit(chunk_of(cursor)->starts, granule_of(cursor));
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        thread->cursor = cursor + total;
+        return cursor + header_size;
+    }
+
+    return allocate_slow(total);
+}
+
+void *acorn_gc_reallocate(void *pointer, int64_t old_size, int64_t new_size) {
+    auto result = acorn_gc_allocate(new_size);
+    if (result != nullptr && pointer != nullptr) {
+        memcpy(result, pointer, old_size < new_size ? old_size : new_size);
+    }
+
+    return result;
+}
+
+void acorn_gc_collect(void) {
+    pthread_mutex_lock(&heap_lock);
+    initialise();
+    register_thread();
+    collect();
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void acorn_gc_add_root(void *start, int64_t size) {
+    pthread_mutex_lock(&heap_lock);
+    auto range_start = static_cast<char *>(start);
+    roots.push({ range_start, range_start + size });
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void acorn_gc_register_thread(void) {
+    pthread_mutex_lock(&heap_lock);
+    initialise();
+    register_thread();
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void acorn_gc_unregister_thread(void) {
+    pthread_mutex_lock(&heap_lock);
+
+    auto thread = current_thread;
+    if (thread != nullptr) {
+        for (auto link = &threads; *link != nullptr; link = &(*link)->next) {
+            if (*link == thread) {
+                *link = thread->next;
+                break;
+            }
+        }
+
+        current_thread = nullptr;
+        unmap_pages(thread, sizeof(ThreadRecord));
+    }
+
+    pthread_mutex_unlock(&heap_lock);
+}
+
+int64_t acorn_gc_live_bytes(void) {
+    pthread_mutex_lock(&heap_lock);
+    auto result = live_bytes;
+    pthread_mutex_unlock(&heap_lock);
+    return result;
+}
+
+int64_t acorn_gc_heap_bytes(void) {
+    pthread_mutex_lock(&heap_lock);
+    auto result = chunks.size * chunk_size + large_object_bytes;
+    pthread_mutex_unlock(&heap_lock);
+    return result;
+}
+
+}
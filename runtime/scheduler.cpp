@@ -0,0 +1,396 @@
+// A work-stealing task scheduler.
+//
+// There is one worker thread per core, started the first time something is spawned. Each
+// worker owns a Chase-Lev deque: it pushes and pops its own tasks at the bottom without
+// any locking, and idle workers steal from the top of someone else's. Threads that aren't
+// workers, like the main thread, push into a shared injection deque instead, serialised
+// by a mutex on the push side only. Joining a task that hasn't finished yet runs other
+// tasks in the meantime, so a worker blocked on a child keeps its core busy and nested
+// spawns can't deadlock the pool.
+//
+// Anything else that has to wait, like a full channel, goes through acorn_task_wait
+// instead. Running a task there could bury the one that would have unblocked us further
+// down the same stack, so waiting never runs tasks itself. What it does do is make sure
+// queued work has a thread: if there are tasks and no worker is asleep to take them, then
+// every worker may be blocked, and a waiter starts an extra one to compensate.
+//
+// Tasks and their frames live on the garbage collected heap. The deques are registered
+// as roots, so a task that is queued but not yet running keeps its frame alive. A slot
+// isn't cleared when its task is taken, since a thief may still be reading it, which
+// means a finished task can live until its slot is reused; it's only ever one word.
+//
+// Like the collector this is linked into every program, so it sticks to libc and pthreads.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "acornrt.h"
+
+namespace {
+
+    const int64_t deque_capacity = 1 << 12;
+    const int maximum_workers = 64;
+    const int maximum_extra_workers = 256;
+    const int spins_before_sleeping = 64;
+    const int64_t waits_before_compensating = 64;
+    const int64_t waits_before_backing_off = 1024;
+
+    struct Task {
+        acorn_task_function function;
+        void *frame;
+        int done;
+    };
+
+    struct Deque {
+        int64_t top;
+        char top_padding[64 - sizeof(int64_t)];
+
+        int64_t bottom;
+        char bottom_padding[64 - sizeof(int64_t)];
+
+        Task **slots;
+    };
+
+    // the Chase-Lev deque, with the memory orderings from "Correct and Efficient Work-Stealing
+    // for Weak Memory Models" (Lê et al.), minus growing: a full deque runs the task inline
+
+    bool push(Deque *deque, Task *task) {
+        auto bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+        auto top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+        if (bottom - top >= deque_capacity) {
+            return false;
+        }
+
+        __atomic_store_n(&deque->slots[bottom & (deque_capacity - 1)], task, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    Task *pop(Deque *deque) {
+        auto bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+        __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        auto top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+        if (top > bottom) {
+            __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+            return nullptr;
+        }
+
+        auto task = __atomic_load_n(&deque->slots[bottom & (deque_capacity - 1)], __ATOMIC_RELAXED);
+        if (top == bottom) {
+            // the last task, so race any thieves for it
+            if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                task = nullptr;
+            }
+
+            __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        }
+
+        return task;
+    }
+
+    Task *steal(Deque *deque) {
+        auto top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        auto bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        auto task = __atomic_load_n(&deque->slots[top & (deque_capacity - 1)], __ATOMIC_RELAXED);
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            return nullptr;
+        }
+
+        return task;
+    }
+
+    bool is_empty(Deque *deque) {
+        return __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST) >= __atomic_load_n(&deque->bottom, __ATOMIC_SEQ_CST);
+    }
+
+    pthread_once_t started = PTHREAD_ONCE_INIT;
+
+    // deques[0] is the injection deque, workers own the rest
+    Deque *deques;
+    int deque_count;
+
+    pthread_mutex_t injection_lock = PTHREAD_MUTEX_INITIALIZER;
+
+    pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t sleep_condition = PTHREAD_COND_INITIALIZER;
+    int sleeping;
+
+    int extra_workers;
+
+    thread_local Deque *current_deque;
+    thread_local uint64_t random_state;
+
+    uint64_t next_random() {
+        // xorshift64, only used to pick victims so it needn't be any good
+        auto x = random_state;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        random_state = x;
+        return x;
+    }
+
+    void run(Task *task) {
+        task->function(task->frame);
+        __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+    }
+
+    Task *find_task() {
+        if (current_deque != nullptr) {
+            if (auto task = pop(current_deque)) {
+                return task;
+            }
+        }
+
+        // start from a random victim so thieves spread out rather than all hitting the same deque
+        auto first = static_cast<int>(next_random() % deque_count);
+        for (int i = 0; i < deque_count; i++) {
+            auto victim = &deques[(first + i) % deque_count];
+            if (victim == current_deque) {
+                continue;
+            }
+
+            if (auto task = steal(victim)) {
+                return task;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool has_work() {
+        for (int i = 0; i < deque_count; i++) {
+            if (!is_empty(&deques[i])) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void wake_worker() {
+        // pairs with the fence in sleep_until_work, so either we see the sleeper or it sees our task
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&sleeping, __ATOMIC_RELAXED) > 0) {
+            pthread_mutex_lock(&sleep_lock);
+            pthread_cond_signal(&sleep_condition);
+            pthread_mutex_unlock(&sleep_lock);
+        }
+    }
+
+    void sleep_until_work() {
+        pthread_mutex_lock(&sleep_lock);
+
+        __atomic_add_fetch(&sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (!has_work()) {
+            pthread_cond_wait(&sleep_condition, &sleep_lock);
+        }
+
+        __atomic_sub_fetch(&sleeping, 1, __ATOMIC_RELAXED);
+
+        pthread_mutex_unlock(&sleep_lock);
+    }
+
+    void *worker_main(void *argument) {
+        acorn_gc_register_thread();
+
+        // extra workers have no deque, what they spawn goes through the injection deque
+        current_deque = static_cast<Deque *>(argument);
+        random_state = reinterpret_cast<uintptr_t>(&argument) | 1;
+
+        int spins = 0;
+        while (true) {
+            if (auto task = find_task()) {
+                run(task);
+                spins = 0;
+            } else if (++spins < spins_before_sleeping) {
+                sched_yield();
+            } else {
+                sleep_until_work();
+                spins = 0;
+            }
+        }
+
+        return nullptr;
+    }
+
+    int count_workers() {
+        auto cores = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cores < 1) {
+            return 1;
+        } else if (cores > maximum_workers) {
+            return maximum_workers;
+        } else {
+            return static_cast<int>(cores);
+        }
+    }
+
+    // only the thread that forked carries on in a child process, so the workers counted here
+    // don't exist there; forgetting them has waiters start new ones for whatever is queued
+    void forget_workers() {
+        injection_lock = PTHREAD_MUTEX_INITIALIZER;
+        sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+        sleeping = 0;
+        extra_workers = 0;
+    }
+
+    void start() {
+        pthread_atfork(nullptr, nullptr, forget_workers);
+
+        auto workers = count_workers();
+
+        auto size = sizeof(Deque) * (workers + 1);
+        auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return;
+        }
+
+        auto all_deques = static_cast<Deque *>(memory);
+        for (int i = 0; i < workers + 1; i++) {
+            auto slots_size = sizeof(Task *) * deque_capacity;
+            auto slots = mmap(nullptr, slots_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (slots == MAP_FAILED) {
+                workers = i - 1;
+                break;
+            }
+
+            all_deques[i].slots = static_cast<Task **>(slots);
+
+            // a queued task is only referenced from here, so the collector has to look
+            acorn_gc_add_root(slots, slots_size);
+        }
+
+        if (workers < 0) {
+            return;
+        }
+
+        // set before any worker starts, a deque whose worker failed to start just stays empty
+        deques = all_deques;
+        deque_count = workers + 1;
+
+        for (int i = 1; i <= workers; i++) {
+            pthread_t thread;
+            if (pthread_create(&thread, nullptr, worker_main, &deques[i]) != 0) {
+                break;
+            }
+
+            pthread_detach(thread);
+        }
+    }
+
+    void compensate() {
+        if (deques == nullptr || !has_work()) {
+            return;
+        }
+
+        if (__atomic_load_n(&sleeping, __ATOMIC_SEQ_CST) > 0) {
+            wake_worker();
+            return;
+        }
+
+        if (__atomic_fetch_add(&extra_workers, 1, __ATOMIC_RELAXED) >= maximum_extra_workers) {
+            __atomic_fetch_sub(&extra_workers, 1, __ATOMIC_RELAXED);
+            return;
+        }
+
+        pthread_t thread;
+        if (pthread_create(&thread, nullptr, worker_main, nullptr) == 0) {
+            pthread_detach(thread);
+        } else {
+            __atomic_fetch_sub(&extra_workers, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+}
+
+extern "C" {
+
+void *acorn_task_spawn(acorn_task_function function, void *frame) {
+    auto task = static_cast<Task *>(acorn_gc_allocate(sizeof(Task)));
+    task->function = function;
+    task->frame = frame;
+
+    if (function == nullptr) {
+        task->done = 1;
+        return task;
+    }
+
+    pthread_once(&started, start);
+
+    bool queued = false;
+    if (current_deque != nullptr) {
+        queued = push(current_deque, task);
+    } else if (deques != nullptr) {
+        pthread_mutex_lock(&injection_lock);
+        queued = push(&deques[0], task);
+        pthread_mutex_unlock(&injection_lock);
+    }
+
+    if (queued) {
+        wake_worker();
+    } else {
+        // no room to queue it, so spawning degrades to calling
+        run(task);
+    }
+
+    return task;
+}
+
+void *acorn_task_join(void *handle) {
+    auto task = static_cast<Task *>(handle);
+
+    pthread_once(&started, start);
+
+    if (random_state == 0) {
+        random_state = reinterpret_cast<uintptr_t>(&handle) | 1;
+    }
+
+    int64_t waits = 0;
+    while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+        // help out rather than block, the task we're waiting for may well be one we'd pick
+        if (deques != nullptr) {
+            if (auto other = find_task()) {
+                run(other);
+                waits = 0;
+                continue;
+            }
+        }
+
+        acorn_task_wait(waits++);
+    }
+
+    return task->frame;
+}
+
+void acorn_task_wait(int64_t waits) {
+    pthread_once(&started, start);
+
+    if (waits % waits_before_compensating == waits_before_compensating - 1) {
+        compensate();
+    }
+
+    if (waits < waits_before_backing_off) {
+        sched_yield();
+    } else {
+        struct timespec pause = { 0, 50 * 1000 };
+        nanosleep(&pause, nullptr);
+    }
+}
+
+}
@@ -1,20 +1,166 @@
 #include <iostream>
 #include <memory>
 
+#include <llvm/ADT/SmallString.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/ManagedStatic.h>
 
 #include "acorn/compiler.h"
 #include "acorn/prettyprinter.h"
+#include "acorn/server.h"
 
 using namespace acorn;
 
 llvm::cl::opt<std::string> input_filename(
-    llvm::cl::Positional, llvm::cl::desc("<input file>"), llvm::cl::Required
+    llvm::cl::Positional, llvm::cl::desc("<input file>")
+);
+
+llvm::cl::opt<char> optimisation_level(
+    "O", llvm::cl::desc("Optimisation level: -O0, -O1, -O2, -O3, -Os or -Oz (default -O0)"),
+    llvm::cl::Prefix, llvm::cl::ZeroOrMore, llvm::cl::init('0')
+);
+
+llvm::cl::opt<unsigned> jobs(
+    "j", llvm::cl::desc("Split the module and generate code on this many threads (default 1)"),
+    llvm::cl::Prefix, llvm::cl::init(1)
+);
+
+llvm::cl::opt<std::string> cache_directory(
+    "cache-dir", llvm::cl::desc("Reuse executables from previous identical compiles stored in this directory"),
+    llvm::cl::value_desc("directory")
+);
+
+llvm::cl::opt<bool> time_phases(
+    "time-phases", llvm::cl::desc("Print the time and memory used by each compiler phase, and LLVM's pass timings")
+);
+
+llvm::cl::opt<std::string> statistics_filename(
+    "stats-file", llvm::cl::desc("Write phase timings and compiler counters as JSON to this file"),
+    llvm::cl::value_desc("filename")
+);
+
+llvm::cl::opt<compiler::EmitKind> emit_kind(
+    "emit", llvm::cl::desc("What to produce (default exe)"),
+    llvm::cl::values(
+        clEnumValN(compiler::EmitKind::AST, "ast", "The checked AST, pretty printed"),
+        clEnumValN(compiler::EmitKind::LLVMIR, "llvm-ir", "Optimised LLVM IR"),
+        clEnumValN(compiler::EmitKind::Bitcode, "bc", "Optimised LLVM bitcode"),
+        clEnumValN(compiler::EmitKind::Assembly, "asm", "Target assembly"),
+        clEnumValN(compiler::EmitKind::Object, "obj", "An object file"),
+        clEnumValN(compiler::EmitKind::Executable, "exe", "A linked executable")
+    ),
+    llvm::cl::init(compiler::EmitKind::Executable)
+);
+
+llvm::cl::opt<std::string> output_filename(
+    "o", llvm::cl::desc("Output filename, or - for stdout"), llvm::cl::value_desc("filename")
+);
+
+llvm::cl::opt<std::string> target(
+    "target", llvm::cl::desc("Generate code for this target triple instead of the host"),
+    llvm::cl::value_desc("triple")
+);
+
+llvm::cl::opt<bool> run(
+    "run", llvm::cl::desc("Run the program in-process with the JIT instead of building an executable")
+);
+
+llvm::cl::opt<std::string> server_socket(
+    "server", llvm::cl::desc("Serve compile requests on this Unix socket instead of compiling"),
+    llvm::cl::value_desc("socket")
+);
+
+llvm::cl::opt<std::string> connect_socket(
+    "connect", llvm::cl::desc("Send the compile to a server listening on this Unix socket"),
+    llvm::cl::value_desc("socket")
 );
 
 int main(int argc, char *argv[]) {
+    llvm::llvm_shutdown_obj shutdown;
+
     llvm::cl::ParseCommandLineOptions(argc, argv);
 
+    if (!server_socket.empty()) {
+        server::Server server(server_socket);
+        return server.serve();
+    }
+
+    if (input_filename.empty()) {
+        std::cerr << "acornc: no input file" << std::endl;
+        return 1;
+    }
+
+    unsigned int level = 0;
+    unsigned int size_level = 0;
+
+    switch (optimisation_level) {
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+            level = optimisation_level - '0';
+            break;
+        case 's':
+            level = 2;
+            size_level = 1;
+            break;
+        case 'z':
+            level = 2;
+            size_level = 2;
+            break;
+        default:
+            std::cerr << "acornc: invalid optimisation level -O" << optimisation_level << std::endl;
+            return 1;
+    }
+
+    if (jobs == 0) {
+        std::cerr << "acornc: -j must be at least 1" << std::endl;
+        return 1;
+    }
+
+    if (!connect_socket.empty()) {
+        if (run || time_phases || !statistics_filename.empty()) {
+            std::cerr << "acornc: --run, --time-phases and --stats-file can't be used with --connect" << std::endl;
+            return 1;
+        }
+
+        llvm::SmallString<128> working_directory;
+        llvm::sys::fs::current_path(working_directory);
+
+        server::Request request;
+        request.working_directory = working_directory.str();
+        request.filename = input_filename;
+        request.output_filename = output_filename;
+        request.target = target;
+        request.cache_directory = cache_directory;
+        request.emit_kind = emit_kind;
+        request.optimisation_level = level;
+        request.size_level = size_level;
+        request.jobs = jobs;
+
+        int exit_code = server::send_request(connect_socket, request);
+        return exit_code < 0 ? 1 : exit_code;
+    }
+
     compiler::Compiler compiler;
-    return compiler.parse_and_compile(input_filename);
+    compiler.set_optimisation_level(level, size_level);
+    compiler.set_jobs(jobs);
+    compiler.set_target(target);
+    compiler.set_cache_directory(cache_directory);
+    compiler.set_emit_kind(emit_kind);
+    compiler.set_output_filename(output_filename);
+    compiler.set_time_phases(time_phases);
+    compiler.set_statistics_filename(statistics_filename);
+
+    int exit_code;
+    if (run) {
+        exit_code = compiler.parse_and_run(input_filename);
+    } else {
+        exit_code = compiler.parse_and_compile(input_filename);
+    }
+
+    compiler.report_statistics();
+
+    return exit_code;
 }
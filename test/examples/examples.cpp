@@ -1,4 +1,9 @@
 #include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "catch.hpp"
 
@@ -22,10 +27,181 @@ int compile_and_run(const std::string filename) {
     return exit_code;
 }
 
+int run_in_jit(const std::string filename) {
+    std::string full_filename = "test/examples/" + filename + ".acorn";
+
+    // programs end by calling exit, so each one gets a process of its own
+    auto pid = fork();
+    if (pid == 0) {
+        acorn::compiler::Compiler compiler;
+        _exit(compiler.parse_and_run(full_filename));
+    }
+
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+
+    return WEXITSTATUS(status);
+}
+
+std::string compile_to_ir(const std::string filename, unsigned int optimisation_level) {
+    std::string full_filename = "test/examples/" + filename + ".acorn";
+
+    std::string ir_filename = "test/examples/" + filename + ".ll";
+
+    acorn::compiler::Compiler compiler;
+    compiler.set_emit_kind(acorn::compiler::EmitKind::LLVMIR);
+    compiler.set_optimisation_level(optimisation_level);
+    compiler.set_output_filename(ir_filename);
+
+    std::stringstream ir;
+    if (compiler.parse_and_compile(full_filename) == 0) {
+        ir << std::ifstream(ir_filename).rdbuf();
+    }
+
+    std::remove(ir_filename.c_str());
+
+    return ir.str();
+}
+
+// the definition of the first function generated for a method with this name
+std::string function_ir(const std::string &ir, const std::string name) {
+    auto position = ir.find("define ");
+    while (position != std::string::npos) {
+        auto end = ir.find("\n}\n", position);
+        auto line = ir.substr(position, ir.find('\n', position) - position);
+
+        if (line.find("@_A_" + name + "_") != std::string::npos) {
+            return ir.substr(position, end - position);
+        }
+
+        position = ir.find("\ndefine ", end);
+        if (position != std::string::npos) {
+            position++;
+        }
+    }
+
+    return "";
+}
+
 SCENARIO("example programs") {
     GIVEN("a program which should compile") {
+        REQUIRE(compile_and_run("arrays") == 0);
+        REQUIRE(compile_and_run("assignments") == 0);
+        REQUIRE(compile_and_run("base_library") == 0);
+        REQUIRE(compile_and_run("bodies") == 0);
+        REQUIRE(compile_and_run("builtin_values") == 0);
+        REQUIRE(compile_and_run("channels") == 0);
+        REQUIRE(compile_and_run("dictionaries") == 0);
+        REQUIRE(compile_and_run("generic_calls") == 0);
+        REQUIRE(compile_and_run("generic_records") == 0);
         REQUIRE(compile_and_run("generics") == 0);
+        REQUIRE(compile_and_run("heap_allocations") == 0);
+        REQUIRE(compile_and_run("lists") == 0);
+        REQUIRE(compile_and_run("loops") == 0);
         REQUIRE(compile_and_run("minimal") == 0);
+        REQUIRE(compile_and_run("modules") == 0);
+        REQUIRE(compile_and_run("pointers") == 0);
         REQUIRE(compile_and_run("records") == 0);
+        REQUIRE(compile_and_run("stack_allocations") == 0);
+        REQUIRE(compile_and_run("stack_lists") == 0);
+        REQUIRE(compile_and_run("strings") == 0);
+        REQUIRE(compile_and_run("switch") == 0);
+        REQUIRE(compile_and_run("tasks") == 0);
+        REQUIRE(compile_and_run("void_methods") == 0);
+    }
+
+    GIVEN("a program which should run in the JIT") {
+        REQUIRE(run_in_jit("arrays") == 0);
+        REQUIRE(run_in_jit("assignments") == 0);
+        REQUIRE(run_in_jit("base_library") == 0);
+        REQUIRE(run_in_jit("bodies") == 0);
+        REQUIRE(run_in_jit("builtin_values") == 0);
+        REQUIRE(run_in_jit("channels") == 0);
+        REQUIRE(run_in_jit("dictionaries") == 0);
+        REQUIRE(run_in_jit("generic_calls") == 0);
+        REQUIRE(run_in_jit("generic_records") == 0);
+        REQUIRE(run_in_jit("generics") == 0);
+        REQUIRE(run_in_jit("lists") == 0);
+        REQUIRE(run_in_jit("loops") == 0);
+        REQUIRE(run_in_jit("minimal") == 0);
+        REQUIRE(run_in_jit("modules") == 0);
+        REQUIRE(run_in_jit("pointers") == 0);
+        REQUIRE(run_in_jit("records") == 0);
+        REQUIRE(run_in_jit("strings") == 0);
+        REQUIRE(run_in_jit("switch") == 0);
+        REQUIRE(run_in_jit("tasks") == 0);
+        REQUIRE(run_in_jit("void_methods") == 0);
+    }
+
+    GIVEN("a program which should abort") {
+        REQUIRE(compile_and_run("array_bounds") > 0);
+        REQUIRE(compile_and_run("string_bounds") > 0);
+    }
+
+    GIVEN("a program which should not compile") {
+        REQUIRE(compile_and_run("constant_assignment") == -1);
+        REQUIRE(compile_and_run("float_keys") == -1);
+        REQUIRE(compile_and_run("loop_records") == -1);
+        REQUIRE(compile_and_run("return_mismatch") == -1);
+    }
+}
+
+SCENARIO("generating code for example programs") {
+    GIVEN("a generic method only called with some types from top level code") {
+        auto ir = compile_to_ir("unreachable_specialisations", 0);
+
+        THEN("only those specialisations are generated") {
+            REQUIRE(function_ir(ir, "identity").find("i64 %value") != std::string::npos);
+            REQUIRE(ir.find("double %value") == std::string::npos);
+            REQUIRE(function_ir(ir, "never_called").empty());
+        }
+    }
+
+    GIVEN("a generic method called twice with the same types") {
+        auto ir = compile_to_ir("generics", 0);
+
+        THEN("it's only specialised once") {
+            REQUIRE(function_ir(ir, "test_explicit").find("i64 %x") != std::string::npos);
+
+            size_t count = 0;
+            for (auto position = ir.find("@_A_test_explicit_"); position != std::string::npos;
+                 position = ir.find("@_A_test_explicit_", position + 1)) {
+                auto line_start = ir.rfind('\n', position) + 1;
+                if (ir.compare(line_start, 7, "define ") == 0) {
+                    count++;
+                }
+            }
+            REQUIRE(count == 1);
+        }
+    }
+
+    GIVEN("a small allocation that never outlives a loop iteration") {
+        auto ir = compile_to_ir("stack_allocations", 2);
+
+        THEN("it's moved to the stack") {
+            auto sum_squares = function_ir(ir, "sum_squares");
+            REQUIRE_FALSE(sum_squares.empty());
+            REQUIRE(sum_squares.find("@acorn_gc_allocate") == std::string::npos);
+        }
+    }
+
+    GIVEN("a list literal that never outlives a loop iteration") {
+        auto ir = compile_to_ir("stack_lists", 2);
+
+        THEN("its storage is moved to the stack") {
+            auto sum_pairs = function_ir(ir, "sum_pairs");
+            REQUIRE_FALSE(sum_pairs.empty());
+            REQUIRE(sum_pairs.find("@acorn_gc_allocate") == std::string::npos);
+        }
+    }
+
+    GIVEN("an allocation returned to the caller") {
+        auto ir = compile_to_ir("heap_allocations", 2);
+
+        THEN("it stays on the heap") {
+            REQUIRE(function_ir(ir, "squares").find("@acorn_gc_allocate") != std::string::npos);
+        }
     }
 }
@@ -3,8 +3,10 @@
 
 #include <catch.hpp>
 
+#include "acorn/ast/cloner.h"
 #include "acorn/ast/nodes.h"
 #include "acorn/parser/scanner.h"
+#include "acorn/prettyprinter.h"
 
 #include "acorn/parser/parser.h"
 
@@ -28,6 +30,77 @@ SCENARIO("parsing source code into an AST") {
             THEN("it should parse") {
                 REQUIRE(source_file != nullptr);
             }
+
+            THEN("a copy of it should be the same") {
+                auto copy = acorn::ast::clone(source_file.get());
+
+                acorn::PrettyPrinter original_printer;
+                original_printer.visit_source_file(source_file.get());
+
+                acorn::PrettyPrinter copy_printer;
+                copy_printer.visit_source_file(copy.get());
+
+                REQUIRE(copy != source_file);
+                REQUIRE(copy_printer.str() == original_printer.str());
+            }
+        }
+
+        WHEN("its bodies have several expressions") {
+            std::string code =
+                "def main(a as Int)\n"
+                "  let b = a\n"
+                "  while b < 10\n"
+                "    test(a)\n"
+                "    test(b)\n"
+                "  end\n"
+                "  if a == 0\n"
+                "    test(a)\n"
+                "    test(b)\n"
+                "  else\n"
+                "    test(b)\n"
+                "    test(a)\n"
+                "  end\n"
+                "end\n";
+
+            Scanner scanner(code, "bodies.acorn");
+            Parser parser(scanner);
+
+            auto source_file = parser.parse("bodies.acorn");
+
+            THEN("every body keeps all of them") {
+                REQUIRE(source_file != nullptr);
+
+                auto definition = llvm::cast<acorn::ast::DefDecl>(source_file->code()->expressions()[0]);
+                auto body = llvm::cast<acorn::ast::Block>(definition->body().get());
+                REQUIRE(body->expressions().size() == 3);
+
+                auto loop = llvm::cast<acorn::ast::While>(body->expressions()[1]);
+                REQUIRE(llvm::cast<acorn::ast::Block>(loop->body().get())->expressions().size() == 2);
+
+                auto branch = llvm::cast<acorn::ast::If>(body->expressions()[2]);
+                REQUIRE(llvm::cast<acorn::ast::Block>(branch->true_case().get())->expressions().size() == 2);
+                REQUIRE(llvm::cast<acorn::ast::Block>(branch->false_case().get())->expressions().size() == 2);
+            }
+        }
+
+        WHEN("it imports a file that another import already brings in") {
+            std::string code =
+                "import \"builtin\"\n"
+                "import \"builtin/types\"\n"
+                "import \"builtin\"\n";
+
+            Scanner scanner(code, "imports.acorn");
+            Parser parser(scanner);
+
+            auto source_file = parser.parse("imports.acorn");
+
+            THEN("only the first time it's reached is kept") {
+                REQUIRE(source_file != nullptr);
+                REQUIRE(source_file->imports().size() == 1);
+
+                auto &builtin = source_file->imports()[0];
+                REQUIRE(builtin->imports().size() == 2);
+            }
         }
     }
 }
@@ -0,0 +1,129 @@
+#include <catch.hpp>
+
+#include "acornrt.h"
+
+struct PipelineFrame {
+    int64_t result;
+    void *channel;
+    int64_t count;
+};
+
+static bool try_send(void *channel, int64_t value) {
+    auto element = static_cast<int64_t *>(acorn_channel_claim_send(channel, false));
+    if (element == nullptr) {
+        return false;
+    }
+
+    *element = value;
+    acorn_channel_publish(channel, element);
+    return true;
+}
+
+static bool try_receive(void *channel, int64_t *value) {
+    auto element = static_cast<int64_t *>(acorn_channel_claim_receive(channel, false));
+    if (element == nullptr) {
+        return false;
+    }
+
+    *value = *element;
+    acorn_channel_release(channel, element);
+    return true;
+}
+
+static void produce(void *frame) {
+    auto pipeline_frame = static_cast<PipelineFrame *>(frame);
+
+    for (int64_t i = 1; i <= pipeline_frame->count; i++) {
+        auto element = static_cast<int64_t *>(acorn_channel_claim_send(pipeline_frame->channel, true));
+        *element = i;
+        acorn_channel_publish(pipeline_frame->channel, element);
+    }
+}
+
+static void consume(void *frame) {
+    auto pipeline_frame = static_cast<PipelineFrame *>(frame);
+
+    int64_t total = 0;
+    for (int64_t i = 0; i < pipeline_frame->count; i++) {
+        auto element = static_cast<int64_t *>(acorn_channel_claim_receive(pipeline_frame->channel, true));
+        total += *element;
+        acorn_channel_release(pipeline_frame->channel, element);
+    }
+
+    pipeline_frame->result = total;
+}
+
+static void *spawn_stage(acorn_task_function function, void *channel, int64_t count) {
+    auto frame = static_cast<PipelineFrame *>(acorn_gc_allocate(sizeof(PipelineFrame)));
+    frame->channel = channel;
+    frame->count = count;
+    return acorn_task_spawn(function, frame);
+}
+
+SCENARIO("sending values through a channel") {
+    acorn_gc_initialise();
+
+    GIVEN("a channel") {
+        auto channel = acorn_channel_create(4, sizeof(int64_t));
+
+        THEN("its capacity is rounded up to a power of two") {
+            REQUIRE(acorn_channel_capacity(channel) == 4);
+            REQUIRE(acorn_channel_capacity(acorn_channel_create(5, sizeof(int64_t))) == 8);
+        }
+
+        WHEN("it is filled") {
+            for (int64_t i = 0; i < 4; i++) {
+                REQUIRE(try_send(channel, i));
+            }
+
+            THEN("it refuses any more") {
+                REQUIRE_FALSE(try_send(channel, 4));
+            }
+
+            THEN("values come out in the order they went in") {
+                for (int64_t i = 0; i < 4; i++) {
+                    int64_t value;
+                    REQUIRE(try_receive(channel, &value));
+                    REQUIRE(value == i);
+                }
+
+                int64_t value;
+                REQUIRE_FALSE(try_receive(channel, &value));
+            }
+        }
+
+        WHEN("it is used for more than its capacity") {
+            for (int64_t i = 0; i < 100; i++) {
+                REQUIRE(try_send(channel, i));
+
+                int64_t value;
+                REQUIRE(try_receive(channel, &value));
+                REQUIRE(value == i);
+            }
+        }
+    }
+
+    GIVEN("more producers and consumers than workers") {
+        const int stages = 8;
+        const int64_t count = 10000;
+
+        auto channel = acorn_channel_create(16, sizeof(int64_t));
+
+        void *consumers[stages];
+        void *producers[stages];
+        for (int i = 0; i < stages; i++) {
+            consumers[i] = spawn_stage(consume, channel, count);
+            producers[i] = spawn_stage(produce, channel, count);
+        }
+
+        THEN("every value is received exactly once") {
+            int64_t total = 0;
+            for (int i = 0; i < stages; i++) {
+                acorn_task_join(producers[i]);
+                total += static_cast<PipelineFrame *>(acorn_task_join(consumers[i]))->result;
+            }
+
+            REQUIRE(total == stages * count * (count + 1) / 2);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include <catch.hpp>
+
+#include <string.h>
+
+#include "acornrt.h"
+
+struct String {
+    const char *bytes;
+    int64_t length;
+};
+
+static void set(void *dictionary, int64_t key, int64_t value) {
+    *static_cast<int64_t *>(acorn_dictionary_insert(dictionary, &key)) = value;
+}
+
+static int64_t get(void *dictionary, int64_t key) {
+    return *static_cast<int64_t *>(acorn_dictionary_lookup(dictionary, &key));
+}
+
+static bool contains(void *dictionary, int64_t key) {
+    return acorn_dictionary_find(dictionary, &key) != nullptr;
+}
+
+static bool remove(void *dictionary, int64_t key) {
+    return acorn_dictionary_remove(dictionary, &key) != 0;
+}
+
+SCENARIO("storing values in a dictionary") {
+    acorn_gc_initialise();
+
+    GIVEN("an empty dictionary") {
+        auto dictionary = acorn_dictionary_create(0, sizeof(int64_t), sizeof(int64_t), 0);
+
+        THEN("it has nothing in it") {
+            REQUIRE(acorn_dictionary_length(dictionary) == 0);
+            REQUIRE_FALSE(contains(dictionary, 1));
+            REQUIRE_FALSE(remove(dictionary, 1));
+        }
+
+        WHEN("it grows well past its first capacity") {
+            const int64_t count = 10000;
+            for (int64_t i = 0; i < count; i++) {
+                set(dictionary, i * 7919, i);
+            }
+
+            THEN("every key keeps its value") {
+                REQUIRE(acorn_dictionary_length(dictionary) == count);
+                for (int64_t i = 0; i < count; i++) {
+                    REQUIRE(get(dictionary, i * 7919) == i);
+                }
+
+                REQUIRE_FALSE(contains(dictionary, 1));
+            }
+
+            THEN("setting a key again replaces its value") {
+                set(dictionary, 7919, -1);
+                REQUIRE(get(dictionary, 7919) == -1);
+                REQUIRE(acorn_dictionary_length(dictionary) == count);
+            }
+
+            THEN("it survives a collection") {
+                acorn_gc_collect();
+                REQUIRE(get(dictionary, (count - 1) * 7919) == count - 1);
+            }
+        }
+
+        WHEN("keys are removed and added over and over") {
+            for (int64_t i = 0; i < 100000; i++) {
+                set(dictionary, i, i);
+                if (i >= 10) {
+                    REQUIRE(remove(dictionary, i - 10));
+                }
+            }
+
+            THEN("only the last few are left") {
+                REQUIRE(acorn_dictionary_length(dictionary) == 10);
+                for (int64_t i = 0; i < 100000; i++) {
+                    REQUIRE(contains(dictionary, i) == (i >= 99990));
+                }
+            }
+        }
+    }
+
+    GIVEN("a dictionary built from a literal") {
+        const char *names[] = { "ada", "alan", "grace", "alan" };
+        int64_t ages[] = { 36, 41, 85, 42 };
+
+        String keys[4];
+        for (int i = 0; i < 4; i++) {
+            keys[i] = { names[i], static_cast<int64_t>(strlen(names[i])) };
+        }
+
+        auto dictionary = acorn_dictionary_create_from(4, sizeof(String), sizeof(int64_t), 1, keys, ages);
+
+        THEN("a repeated key takes its last value") {
+            REQUIRE(acorn_dictionary_length(dictionary) == 3);
+        }
+
+        THEN("strings are looked up by their contents") {
+            char buffer[] = "grace hopper";
+            String key = { buffer, 5 };
+
+            REQUIRE(*static_cast<int64_t *>(acorn_dictionary_lookup(dictionary, &key)) == 85);
+
+            key.bytes = "alan";
+            key.length = 4;
+            REQUIRE(*static_cast<int64_t *>(acorn_dictionary_lookup(dictionary, &key)) == 42);
+
+            key.length = 3;
+            REQUIRE(acorn_dictionary_find(dictionary, &key) == nullptr);
+        }
+    }
+}
@@ -0,0 +1,154 @@
+#include <cstring>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <catch.hpp>
+
+#include "acornrt.h"
+
+struct Node {
+    Node *next;
+    int64_t value;
+};
+
+static Node *global_node;
+
+static Node *allocate_list(int64_t length) {
+    Node *head = nullptr;
+    for (int64_t i = 0; i < length; i++) {
+        auto node = static_cast<Node *>(acorn_gc_allocate(sizeof(Node)));
+        node->next = head;
+        node->value = i;
+        head = node;
+    }
+
+    return head;
+}
+
+static void allocate_garbage(int64_t bytes) {
+    for (int64_t allocated = 0; allocated < bytes; allocated += 256) {
+        auto garbage = static_cast<char *>(acorn_gc_allocate(256));
+        std::memset(garbage, 0xff, 256);
+    }
+}
+
+static void allocate_in_task(void *frame) {
+    __atomic_store_n(static_cast<Node **>(frame), allocate_list(10), __ATOMIC_SEQ_CST);
+}
+
+// the child's exit code, or -1 if it's still running after a few seconds
+static int wait_for_exit(pid_t pid) {
+    for (int i = 0; i < 500; i++) {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        }
+
+        usleep(10000);
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    return -1;
+}
+
+static bool list_is_intact(Node *head, int64_t length) {
+    for (int64_t i = length - 1; i >= 0; i--) {
+        if (head == nullptr || head->value != i) {
+            return false;
+        }
+        head = head->next;
+    }
+
+    return head == nullptr;
+}
+
+SCENARIO("collecting garbage") {
+    acorn_gc_initialise();
+
+    GIVEN("a fresh allocation") {
+        auto memory = static_cast<char *>(acorn_gc_allocate(100));
+
+        THEN("it is zeroed") {
+            for (int i = 0; i < 100; i++) {
+                REQUIRE(memory[i] == 0);
+            }
+        }
+    }
+
+    GIVEN("a list only referenced from the stack") {
+        auto head = allocate_list(1000);
+
+        WHEN("the heap is collected") {
+            acorn_gc_collect();
+            allocate_garbage(16 << 20);
+
+            THEN("the list survives") {
+                REQUIRE(list_is_intact(head, 1000));
+            }
+        }
+    }
+
+    GIVEN("a list only referenced from a registered root") {
+        acorn_gc_add_root(&global_node, sizeof(global_node));
+        global_node = allocate_list(1000);
+
+        WHEN("the heap is collected") {
+            acorn_gc_collect();
+            allocate_garbage(16 << 20);
+
+            THEN("the list survives") {
+                REQUIRE(list_is_intact(global_node, 1000));
+            }
+        }
+    }
+
+    GIVEN("an object too large for a thread's buffer") {
+        auto memory = static_cast<char *>(acorn_gc_allocate(1 << 20));
+        memory[(1 << 20) - 1] = 42;
+
+        WHEN("the heap is collected") {
+            acorn_gc_collect();
+
+            THEN("it survives") {
+                REQUIRE(memory[(1 << 20) - 1] == 42);
+            }
+        }
+    }
+
+    GIVEN("a loop allocating far more than it keeps") {
+        allocate_garbage(256 << 20);
+
+        THEN("the heap stays bounded") {
+            REQUIRE(acorn_gc_heap_bytes() < (64 << 20));
+        }
+    }
+
+    GIVEN("a process forked after tasks have run on other threads") {
+        auto frame = acorn_gc_allocate(sizeof(Node *));
+        auto task = acorn_task_spawn(allocate_in_task, frame);
+
+        // waiting rather than joining, so the task runs on a worker, which registers itself
+        while (__atomic_load_n(static_cast<Node **>(frame), __ATOMIC_SEQ_CST) == nullptr) {
+            usleep(1000);
+        }
+
+        acorn_task_join(task);
+
+        WHEN("the child collects") {
+            auto pid = fork();
+            if (pid == 0) {
+                acorn_gc_collect();
+                allocate_garbage(16 << 20);
+                _exit(list_is_intact(*static_cast<Node **>(frame), 10) ? 0 : 1);
+            }
+
+            THEN("it only waits for its own thread") {
+                REQUIRE(pid > 0);
+                REQUIRE(wait_for_exit(pid) == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#include <catch.hpp>
+
+#include "acornrt.h"
+
+struct SumFrame {
+    int64_t result;
+    int64_t start;
+    int64_t stop;
+};
+
+struct FibonacciFrame {
+    int64_t result;
+    int64_t n;
+};
+
+static void sum(void *frame) {
+    auto sum_frame = static_cast<SumFrame *>(frame);
+
+    int64_t total = 0;
+    for (int64_t i = sum_frame->start; i < sum_frame->stop; i++) {
+        total += i;
+    }
+
+    sum_frame->result = total;
+}
+
+static void *spawn_fibonacci(int64_t n);
+
+static void fibonacci(void *frame) {
+    auto fibonacci_frame = static_cast<FibonacciFrame *>(frame);
+
+    auto n = fibonacci_frame->n;
+    if (n < 2) {
+        fibonacci_frame->result = n;
+        return;
+    }
+
+    // joining from inside a task has to run other tasks rather than block the worker
+    auto left = spawn_fibonacci(n - 1);
+    auto right = spawn_fibonacci(n - 2);
+
+    fibonacci_frame->result =
+        static_cast<FibonacciFrame *>(acorn_task_join(left))->result +
+        static_cast<FibonacciFrame *>(acorn_task_join(right))->result;
+}
+
+static void *spawn_fibonacci(int64_t n) {
+    auto frame = static_cast<FibonacciFrame *>(acorn_gc_allocate(sizeof(FibonacciFrame)));
+    frame->n = n;
+    return acorn_task_spawn(fibonacci, frame);
+}
+
+static void *spawn_sum(int64_t start, int64_t stop) {
+    auto frame = static_cast<SumFrame *>(acorn_gc_allocate(sizeof(SumFrame)));
+    frame->start = start;
+    frame->stop = stop;
+    return acorn_task_spawn(sum, frame);
+}
+
+SCENARIO("running tasks") {
+    acorn_gc_initialise();
+
+    GIVEN("many independent tasks") {
+        const int count = 10000;
+
+        void *tasks[count];
+        for (int i = 0; i < count; i++) {
+            tasks[i] = spawn_sum(0, i);
+        }
+
+        THEN("joining each gives its result") {
+            for (int i = 0; i < count; i++) {
+                auto frame = static_cast<SumFrame *>(acorn_task_join(tasks[i]));
+                REQUIRE(frame->result == int64_t(i) * (i - 1) / 2);
+            }
+        }
+    }
+
+    GIVEN("tasks that spawn and join their own tasks") {
+        auto task = spawn_fibonacci(20);
+
+        THEN("the results are combined") {
+            REQUIRE(static_cast<FibonacciFrame *>(acorn_task_join(task))->result == 6765);
+        }
+    }
+
+    GIVEN("queued tasks while the heap is collected") {
+        auto task = spawn_sum(0, 1000);
+        acorn_gc_collect();
+
+        THEN("their frames survive") {
+            REQUIRE(static_cast<SumFrame *>(acorn_task_join(task))->result == 499500);
+        }
+    }
+
+    GIVEN("a task that is already complete") {
+        auto frame = static_cast<SumFrame *>(acorn_gc_allocate(sizeof(SumFrame)));
+        frame->result = 42;
+
+        auto task = acorn_task_spawn(nullptr, frame);
+
+        THEN("joining returns its frame straight away") {
+            REQUIRE(acorn_task_join(task) == frame);
+        }
+    }
+}